@@ -0,0 +1,304 @@
+/*
+  LittleFS Benchmark
+
+  This program runs a fixed set of filesystem workloads and prints the
+  results as one JSON object per run, so results can be captured from the
+  Serial Monitor and compared between library releases.
+
+  Workloads measured:
+    seq_write     - write one large file in 4K chunks
+    seq_read      - read the same file back in 4K chunks
+    random_read   - 512 byte reads at pseudo-random offsets in that file
+    append        - open, append one small record, close (data logger style)
+    churn         - create, write and delete many small files
+    dir_list      - walk a directory with many entries
+    mount         - unmount and mount the filesystem
+    crc           - littlefs CRC-32 over 4K buffers, no media access
+
+  By default the benchmark runs on a RAM disk, which has no media
+  timing of its own, so the numbers mostly reflect the littlefs core and
+  this library.  Select another media type below to measure a real chip.
+
+  The same benchmark also builds and runs on Linux, see extras/host.
+  There BENCH_SPI_FLASH and BENCH_SPI_NAND run the LittleFS_SPIFlash and
+  LittleFS_SPINAND drivers on simulated chips which answer their SPI
+  commands, and the results also count SPI bus transactions (one per chip
+  select) as "bus_transactions".
+
+  This example code is in the public domain.
+*/
+
+#include <LittleFS.h>
+#include <littlefs/lfs_util.h>
+
+/* \/ == Uncomment ONE of these lines to select the media == \/ */
+#if !defined(BENCH_HOST)      // the host build in extras/host selects it
+#define BENCH_RAM
+//#define BENCH_SPI_FLASH
+//#define BENCH_SPI_NAND
+//#define BENCH_QSPI_FLASH    // Teensy 4.1 only
+//#define BENCH_PROGRAM       // Teensy 4.x only
+#endif
+/* /\ == Uncomment ONE of these lines to select the media == /\ */
+
+// Extra read cache lines for littlefs, zero for the default single line
+#define BENCH_READ_CACHE_LINES  0
+
+// SPI and QSPI NOR flash block size, 4096 for 4K sector erases, zero for
+// the chip's usual erase size.  Changing it formats the chip.
+#define BENCH_BLOCK_SIZE  0
+
+const int chipSelect = 6;  // for SPI media, pin 6 is used by audio and prop shield
+
+#if defined(BENCH_RAM)
+#ifdef __IMXRT1062__
+DMAMEM char ramdisk[480 * 1024];
+#else
+char ramdisk[120 * 1024];
+#endif
+#endif
+
+#if defined(BENCH_RAM)
+typedef LittleFS_RAM media_t;
+#elif defined(BENCH_SPI_FLASH)
+typedef LittleFS_SPIFlash media_t;
+#elif defined(BENCH_SPI_NAND)
+typedef LittleFS_SPINAND media_t;
+#elif defined(BENCH_QSPI_FLASH)
+typedef LittleFS_QSPIFlash media_t;
+#elif defined(BENCH_PROGRAM)
+typedef LittleFS_Program media_t;
+#endif
+
+// Sizes used by the workloads.  The RAM disk on Teensy 3.x is small,
+// so the sequential file is kept to 64K there.
+#if defined(BENCH_RAM) && !defined(__IMXRT1062__)
+#define SEQ_FILE_SIZE   (64 * 1024)
+#else
+#define SEQ_FILE_SIZE   (256 * 1024)
+#endif
+#define CHUNK_SIZE      4096
+#define RANDOM_READS    200
+#define RANDOM_SIZE     512
+#define APPEND_COUNT    200
+#define CHURN_FILES     50
+#define CHURN_SIZE      1000
+#define DIR_FILES       100
+#define CRC_COUNT       250
+
+// Give the benchmark access to the filesystem internals, so it can
+// time a mount without formatting (LittleFS_RAM::begin always formats)
+class BenchFS : public media_t
+{
+public:
+	bool remount() {
+		if (!this->mounted) return false;
+		lfs_unmount(&this->lfs);
+		this->mounted = false;
+		if (lfs_mount(&this->lfs, &this->config) < 0) return false;
+		this->mounted = true;
+		return true;
+	}
+	const lfs_config * cfg() { return &this->config; }
+};
+
+BenchFS myfs;
+uint8_t buf[CHUNK_SIZE];
+bool first_result;
+
+void setup() {
+	Serial.begin(9600);
+	while (!Serial) ; // wait for Arduino Serial Monitor
+	Serial.println("LittleFS Benchmark");
+
+#if defined(BENCH_RAM)
+	bool ok = myfs.begin(ramdisk, sizeof(ramdisk));
+#elif defined(BENCH_SPI_FLASH)
+	bool ok = myfs.begin(chipSelect, SPI, 0, BENCH_BLOCK_SIZE);
+#elif defined(BENCH_SPI_NAND)
+	bool ok = myfs.begin(chipSelect, SPI);
+#elif defined(BENCH_QSPI_FLASH)
+	bool ok = myfs.begin(0, BENCH_BLOCK_SIZE);
+#elif defined(BENCH_PROGRAM)
+	bool ok = myfs.begin(1024 * 1024);
+#else
+	bool ok = myfs.begin();
+#endif
+	if (!ok) {
+		Serial.println("Error starting media");
+		return;
+	}
+	myfs.quickFormat();  // every run starts from the same empty filesystem
+	if (BENCH_READ_CACHE_LINES > 0) myfs.setReadCache(BENCH_READ_CACHE_LINES);
+	for (unsigned int i=0; i < sizeof(buf); i++) buf[i] = i * 7;
+
+	const lfs_config *c = myfs.cfg();
+	Serial.printf("{\"media\":\"%s\",\"block_size\":%u,\"block_count\":%u,"
+		"\"read_size\":%u,\"prog_size\":%u,\"cache_size\":%u,"
+		"\"read_cache_lines\":%u,\"results\":[",
+		myfs.getMediaName(), c->block_size, c->block_count,
+		c->read_size, c->prog_size, c->cache_size, c->read_cache_lines);
+	first_result = true;
+
+	benchSequentialWrite();
+	benchSequentialRead();
+	benchRandomRead();
+	benchAppend();
+	benchChurn();
+	benchDirList();
+	benchMount();
+	benchCrc();
+
+	Serial.println("]}");
+}
+
+void loop() {
+}
+
+// Bus transactions so far, only the host build's simulated chips count them
+uint32_t transactions() {
+#if defined(BENCH_HOST)
+	return SPI.transactions;
+#else
+	return 0;
+#endif
+}
+
+// Print one result, bytes may be zero for tests which are not bandwidth based
+void result(const char *name, uint32_t ops, uint32_t bytes, uint32_t us, uint32_t bus) {
+	if (us == 0) us = 1;
+	Serial.printf("%s\n{\"test\":\"%s\",\"ops\":%u,\"bytes\":%u,\"us\":%u,"
+		"\"us_per_op\":%u,\"bytes_per_sec\":%u",
+		first_result ? "" : ",", name, ops, bytes, us,
+		ops ? us / ops : 0, (uint32_t)((uint64_t)bytes * 1000000 / us));
+#if defined(BENCH_HOST) && (defined(BENCH_SPI_FLASH) || defined(BENCH_SPI_NAND))
+	Serial.printf(",\"bus_transactions\":%u", bus);
+#endif
+	Serial.print("}");
+	first_result = false;
+}
+
+void benchSequentialWrite() {
+	elapsedMicros usec = 0;
+	uint32_t bus = transactions();
+	File f = myfs.open("seq.bin", FILE_WRITE_BEGIN);
+	if (!f) return;
+	for (uint32_t n=0; n < SEQ_FILE_SIZE; n += CHUNK_SIZE) {
+		f.write(buf, CHUNK_SIZE);
+	}
+	f.close();
+	result("seq_write", SEQ_FILE_SIZE / CHUNK_SIZE, SEQ_FILE_SIZE, usec, transactions() - bus);
+}
+
+void benchSequentialRead() {
+	elapsedMicros usec = 0;
+	uint32_t bus = transactions();
+	File f = myfs.open("seq.bin");
+	if (!f) return;
+	uint32_t total = 0;
+	while (1) {
+		size_t n = f.read(buf, CHUNK_SIZE);
+		if (n == 0) break;
+		total += n;
+	}
+	f.close();
+	result("seq_read", total / CHUNK_SIZE, total, usec, transactions() - bus);
+}
+
+void benchRandomRead() {
+	File f = myfs.open("seq.bin");
+	if (!f) return;
+	uint32_t seed = 1;
+	elapsedMicros usec = 0;
+	uint32_t bus = transactions();
+	for (int i=0; i < RANDOM_READS; i++) {
+		seed = seed * 1103515245 + 12345; // fixed sequence, same on every run
+		f.seek((seed >> 8) % (SEQ_FILE_SIZE - RANDOM_SIZE));
+		f.read(buf, RANDOM_SIZE);
+	}
+	uint32_t us = usec;
+	bus = transactions() - bus;
+	f.close();
+	myfs.remove("seq.bin");
+	result("random_read", RANDOM_READS, RANDOM_READS * RANDOM_SIZE, us, bus);
+}
+
+void benchAppend() {
+	char record[40];
+	uint32_t total = 0;
+	elapsedMicros usec = 0;
+	uint32_t bus = transactions();
+	for (int i=0; i < APPEND_COUNT; i++) {
+		File f = myfs.open("append.txt", FILE_WRITE);
+		if (!f) break;
+		int len = snprintf(record, sizeof(record), "%d,%u,%u\n", i, 1234 + i, 5678 - i);
+		total += f.write(record, len);
+		f.close();
+	}
+	uint32_t us = usec;
+	bus = transactions() - bus;
+	myfs.remove("append.txt");
+	result("append", APPEND_COUNT, total, us, bus);
+}
+
+void benchChurn() {
+	char name[16];
+	elapsedMicros usec = 0;
+	uint32_t bus = transactions();
+	for (int i=0; i < CHURN_FILES; i++) {
+		snprintf(name, sizeof(name), "churn%d.dat", i);
+		File f = myfs.open(name, FILE_WRITE_BEGIN);
+		if (!f) break;
+		f.write(buf, CHURN_SIZE);
+		f.close();
+	}
+	for (int i=0; i < CHURN_FILES; i++) {
+		snprintf(name, sizeof(name), "churn%d.dat", i);
+		myfs.remove(name);
+	}
+	result("churn", CHURN_FILES, CHURN_FILES * CHURN_SIZE, usec, transactions() - bus);
+}
+
+void benchDirList() {
+	char name[24];
+	myfs.mkdir("dirtest");
+	for (int i=0; i < DIR_FILES; i++) {
+		snprintf(name, sizeof(name), "dirtest/file%d.txt", i);
+		File f = myfs.open(name, FILE_WRITE_BEGIN);
+		if (f) {
+			f.write(buf, 16);
+			f.close();
+		}
+	}
+	elapsedMicros usec = 0;
+	uint32_t bus = transactions();
+	uint32_t count = 0;
+	File dir = myfs.open("dirtest");
+	while (1) {
+		File entry = dir.openNextFile();
+		if (!entry) break;
+		count++;
+	}
+	dir.close();
+	result("dir_list", count, 0, usec, transactions() - bus);
+}
+
+void benchMount() {
+	elapsedMicros usec = 0;
+	uint32_t bus = transactions();
+	bool ok = myfs.remount();
+	uint32_t us = usec;
+	bus = transactions() - bus;
+	if (ok) result("mount", 1, 0, us, bus);
+}
+
+// lfs_crc checks every metadata read and commit, LFS_CRC_SLICE in
+// lfs_util.h selects its implementation
+void benchCrc() {
+	volatile uint32_t crc = 0xFFFFFFFF;
+	elapsedMicros usec = 0;
+	for (int i=0; i < CRC_COUNT; i++) {
+		crc = lfs_crc(crc, buf, CHUNK_SIZE);
+	}
+	result("crc", CRC_COUNT, CRC_COUNT * CHUNK_SIZE, usec, 0);
+}
@@ -0,0 +1,97 @@
+/*
+  LittleFS Trace Record
+
+  This program records every block operation littlefs makes while a
+  simple data logger runs, and saves the trace to "trace.bin" on the
+  SD card.  Run the TraceReplay example on the saved file to see the
+  time spent in each kind of operation and which blocks were used most.
+
+  The trace is collected into a small RAM ring buffer by the library
+  and copied to the SD card between log records.  If the buffer fills
+  before it is saved, the oldest records are lost, and the number lost
+  is printed at the end.
+
+  Trace file format, all values little endian:
+    header    - "LFST", record size, block size, block count (4 bytes each)
+    records   - LittleFS_TraceRecord, as defined in LittleFS.h
+
+  This example code is in the public domain.
+*/
+
+#include <LittleFS.h>
+#include <SD.h>
+
+// Change the media type and begin() in setup() to trace other media
+typedef LittleFS_Program media_t;
+#define PROG_FLASH_SIZE 1024 * 512
+
+#define LOG_RECORDS  1000   // number of data logger records to write
+#define TRACE_SIZE   512    // records held in RAM before saving
+
+// config is protected in LittleFS, the trace file header needs its geometry
+class TraceFS : public media_t {
+public:
+	uint32_t blockSize() { return config.block_size; }
+	uint32_t blockCount() { return config.block_count; }
+};
+
+TraceFS myfs;
+LittleFS_TraceRecord trace[TRACE_SIZE];
+File tracefile;
+uint32_t saved = 0;
+
+void setup() {
+	Serial.begin(115200);
+	while (!Serial && millis() < 4000) ; // wait for Arduino Serial Monitor
+	Serial.println("LittleFS Trace Record");
+
+	if (!SD.begin(BUILTIN_SDCARD)) {
+		Serial.println("SD card not found");
+		return;
+	}
+	if (!myfs.begin(PROG_FLASH_SIZE)) {
+		Serial.println("Error starting LittleFS");
+		return;
+	}
+	SD.remove("trace.bin");
+	tracefile = SD.open("trace.bin", FILE_WRITE);
+	if (!tracefile) {
+		Serial.println("Unable to create trace.bin");
+		return;
+	}
+	uint32_t header[4] = {0x5453464C, sizeof(LittleFS_TraceRecord),
+		myfs.blockSize(), myfs.blockCount()}; // "LFST"
+	tracefile.write(header, sizeof(header));
+
+	myfs.remove("datalog.txt");
+	myfs.beginTrace(trace, TRACE_SIZE);
+	char record[48];
+	for (int i=0; i < LOG_RECORDS; i++) {
+		File f = myfs.open("datalog.txt", FILE_WRITE);
+		if (!f) break;
+		int len = snprintf(record, sizeof(record), "%d,%d,%d,%d\n",
+			i, analogRead(A0), analogRead(A1), analogRead(A2));
+		f.write(record, len);
+		f.close();
+		saveTrace();
+	}
+	myfs.endTrace();
+	saveTrace();
+	tracefile.close();
+
+	Serial.printf("Saved %u trace records, %u lost\n", saved, myfs.traceLost());
+}
+
+// Copy everything in the trace buffer to the SD card
+void saveTrace() {
+	LittleFS_TraceRecord buf[32];
+	while (1) {
+		uint32_t n = myfs.readTrace(buf, 32);
+		if (n == 0) break;
+		tracefile.write(buf, n * sizeof(LittleFS_TraceRecord));
+		saved += n;
+	}
+}
+
+void loop() {
+}
@@ -0,0 +1,147 @@
+/*
+  LittleFS Trace Replay
+
+  This program reads a block operation trace saved by the TraceRecord
+  example from "trace.bin" on the SD card, and prints:
+
+    - the count, bytes and time of each kind of operation, as recorded
+    - the time the same operations would take on a simulated chip
+    - a per-block heatmap of reads, programs and erases, as CSV
+
+  The simulated chip is a quick estimate: SPI bus time for the command
+  and data, plus the chip's typical read, program and erase times.
+  Select the chip below and change its values to estimate how a trace
+  from the field would run on another chip.  To replay a trace through
+  the library's own drivers, on the RAM disk or simulated SPI chips,
+  use the replay tool of the host build in extras/host.
+
+  This example code is in the public domain.
+*/
+
+#include <LittleFS.h>
+#include <SD.h>
+
+/* \/ == Uncomment ONE of these lines to select the simulated chip == \/ */
+#define SIM_NOR     // Winbond W25Q128JV
+//#define SIM_NAND    // Winbond W25N01GV
+/* /\ == Uncomment ONE of these lines to select the simulated chip == /\ */
+
+#if defined(SIM_NOR)
+#define SIM_PAGE_SIZE   256       // program page size
+#define SIM_READ_US     0         // NOR reads directly from the array
+#define SIM_PROG_US     400       // typical page program time
+#define SIM_ERASE_US    45000     // typical 4K sector erase time
+#define SIM_CMD_BYTES   4         // command + 24 bit address
+#elif defined(SIM_NAND)
+#define SIM_PAGE_SIZE   2048      // data bytes per page
+#define SIM_READ_US     25        // typical page data read (tRD)
+#define SIM_PROG_US     250       // typical page program (tPP)
+#define SIM_ERASE_US    2000      // typical block erase (tBE)
+#define SIM_CMD_BYTES   4         // command + dummy + column address
+#endif
+#define SIM_SPI_CLOCK   30000000  // SCK, same as the LittleFS SPI drivers
+
+const char *opname[] = {"", "read", "prog", "erase", "sync"};
+
+struct {
+	uint32_t count;
+	uint64_t bytes;
+	uint64_t recorded_us;
+	uint64_t simulated_us;
+} summary[5];
+
+// per-block operation counts, allocated once the block count is known
+struct heat {
+	uint32_t reads;
+	uint32_t progs;
+	uint16_t erases;
+} *heatmap;
+
+// simulated time for one operation
+uint32_t simulate(const LittleFS_TraceRecord &r) {
+	uint32_t pages = (r.size + SIM_PAGE_SIZE - 1) / SIM_PAGE_SIZE;
+	uint64_t busbytes = 0, chip_us = 0;
+	switch (r.op) {
+	case LITTLEFS_TRACE_READ:
+		busbytes = SIM_CMD_BYTES + r.size;
+		chip_us = (uint64_t)pages * SIM_READ_US;
+		break;
+	case LITTLEFS_TRACE_PROG:
+		busbytes = pages * (1 + SIM_CMD_BYTES) + r.size; // write enable, command
+		chip_us = (uint64_t)pages * SIM_PROG_US;
+		break;
+	case LITTLEFS_TRACE_ERASE:
+		busbytes = 1 + SIM_CMD_BYTES;
+		chip_us = SIM_ERASE_US;
+		break;
+	}
+	return chip_us + busbytes * 8 * 1000000 / SIM_SPI_CLOCK;
+}
+
+void setup() {
+	Serial.begin(115200);
+	while (!Serial && millis() < 4000) ; // wait for Arduino Serial Monitor
+	Serial.println("LittleFS Trace Replay");
+
+	if (!SD.begin(BUILTIN_SDCARD)) {
+		Serial.println("SD card not found");
+		return;
+	}
+	File tracefile = SD.open("trace.bin");
+	if (!tracefile) {
+		Serial.println("Unable to open trace.bin");
+		return;
+	}
+	uint32_t header[4];
+	if (tracefile.read(header, sizeof(header)) != sizeof(header)
+	  || header[0] != 0x5453464C || header[1] != sizeof(LittleFS_TraceRecord)) {
+		Serial.println("trace.bin is not a LittleFS trace");
+		return;
+	}
+	const uint32_t block_size = header[2];
+	const uint32_t block_count = header[3];
+	heatmap = (struct heat *)calloc(block_count, sizeof(struct heat));
+	if (!heatmap) {
+		Serial.println("Not enough memory for the heatmap");
+		return;
+	}
+	Serial.printf("block size %u, block count %u\n", block_size, block_count);
+
+	LittleFS_TraceRecord r;
+	uint32_t records = 0, errors = 0, first_us = 0, last_us = 0;
+	while (tracefile.read(&r, sizeof(r)) == sizeof(r)) {
+		if (r.op < LITTLEFS_TRACE_READ || r.op > LITTLEFS_TRACE_SYNC) continue;
+		if (records++ == 0) first_us = r.us;
+		last_us = r.us + r.duration_us;
+		if (r.err) errors++;
+		summary[r.op].count++;
+		summary[r.op].bytes += r.size;
+		summary[r.op].recorded_us += r.duration_us;
+		summary[r.op].simulated_us += simulate(r);
+		if (r.block < block_count) {
+			if (r.op == LITTLEFS_TRACE_READ) heatmap[r.block].reads++;
+			if (r.op == LITTLEFS_TRACE_PROG) heatmap[r.block].progs++;
+			if (r.op == LITTLEFS_TRACE_ERASE) heatmap[r.block].erases++;
+		}
+	}
+	tracefile.close();
+	Serial.printf("%u records over %u ms, %u returned errors\n",
+		records, (last_us - first_us) / 1000, errors);
+
+	Serial.println("\nop,count,bytes,recorded_us,simulated_us");
+	for (int op=LITTLEFS_TRACE_READ; op <= LITTLEFS_TRACE_SYNC; op++) {
+		Serial.printf("%s,%u,%llu,%llu,%llu\n", opname[op], summary[op].count,
+			summary[op].bytes, summary[op].recorded_us, summary[op].simulated_us);
+	}
+
+	Serial.println("\nblock,reads,progs,erases");
+	for (uint32_t block=0; block < block_count; block++) {
+		const struct heat &h = heatmap[block];
+		if (h.reads || h.progs || h.erases) {
+			Serial.printf("%u,%u,%u,%u\n", block, h.reads, h.progs, h.erases);
+		}
+	}
+}
+
+void loop() {
+}
@@ -0,0 +1,151 @@
+/* LittleFS for Teensy - host build
+ *
+ * Simulated flash chips, which answer the SPI commands the library's
+ * drivers send, so the real driver code runs on the host.  They keep
+ * the chip's data, enforce what the chip allows, and add the chip's
+ * busy times to the clock.
+ */
+
+#pragma once
+#include <SPI.h>
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+// A chip from the library's tables.  The tables list maximum times, the
+// simulated chips take the typical time, which datasheets give as about
+// an eighth of the maximum.
+#define SIM_TYPICAL_DIVISOR  8
+
+struct SimChip {
+	const char *pn;
+	uint8_t id[3];
+	uint8_t addrbits;       // 24 or 32
+	uint32_t chipsize;      // bytes
+	uint32_t progsize;      // page size
+	uint32_t erasesize;     // usual erase size
+	uint32_t progtime;      // maximum page program time, in us
+	uint32_t erasetime;     // maximum erase time for erasesize
+	uint32_t sectortime;    // maximum 4K sector erase time, 0 for 400 ms
+	bool nosector;          // can't erase 4K sectors
+	uint32_t maxclock;      // SCK, Hz
+	uint32_t sparesize;     // NAND spare bytes after each page
+	uint8_t dies;           // NAND dies selected by 0xC2, 1 if none
+};
+
+// NOR flash chips in the library's known_chips, without the F-RAM.
+// Returns false past the end.
+bool simNORChip(unsigned int index, SimChip &chip);
+// NAND flash chips in LittleFS_SPINAND's known_chips, with the blocks
+// the driver leaves for bad block replacement
+bool simNANDChip(unsigned int index, SimChip &chip);
+// Find a chip by part number, or the first one for nullptr
+bool simFindChip(bool (*list)(unsigned int, SimChip &), const char *pn, SimChip &chip);
+
+// Counts of what a simulated chip was asked to do
+struct SimCounts {
+	uint32_t reads;         // read commands, page data reads for NAND
+	uint32_t progs;         // page programs
+	uint32_t erases;
+	uint32_t status;        // status register reads
+	uint32_t suspends;      // erase suspends which took effect
+	uint32_t errors;        // commands the real chip would ignore or fail
+};
+
+// SPI NOR flash: JEDEC ID 0x9F, read 0x03/0x13, fast read 0x0B/0x0C,
+// page program 0x02/0x12, write enable 0x06/0x04, status 0x05/0x35,
+// erase 0x20/0x21/0x52/0x5C/0xD8/0xDC, suspend and resume 0x75/0x7A,
+// and SFDP 0x5A.  Winbond and GigaDevice chips suspend erases.
+class SimNOR : public SPIClass::Device {
+public:
+	SimNOR(const SimChip &chip);
+	void select();
+	uint8_t transfer(uint8_t data, uint32_t clock);
+	void deselect();
+	// Returned by 0x5A, empty for a chip without SFDP
+	std::vector<uint8_t> sfdp;
+	SimCounts count = {};
+	const char *lastError = "";
+	// Each byte of the chip, 0xFF when erased
+	uint8_t peek(uint32_t addr);
+	// Sectors never erased or programmed read as this, set before use.
+	// Anything but 0xFF makes the chip look used, so every block needs
+	// erasing.
+	uint8_t unwritten = 0xFF;
+private:
+	void error(const char *msg) { count.errors++; lastError = msg; }
+	bool busy() { return host_now_ns() < busy_until; }
+	bool suspended() { return suspend_at && host_now_ns() >= suspend_at; }
+	uint8_t * sector(uint32_t addr, bool write);
+	uint32_t eraseTime(uint32_t size);
+	const SimChip chip;
+	std::vector<std::unique_ptr<uint8_t[]>> sectors; // 4K each, null until used
+	uint8_t cmd = 0;
+	uint32_t bytes = 0;         // sent since chip select went low
+	bool ignore = false;        // the chip ignores this command
+	uint32_t addr = 0;
+	uint32_t addrbytes = 0;
+	uint32_t header = 0;        // command, address and dummy bytes
+	std::vector<uint8_t> page;  // data for page program
+	uint32_t pagebase = 0;
+	std::vector<bool> pagemask;
+	bool wel = false;
+	uint64_t busy_until = 0;    // host_now_ns() when the program or erase ends
+	bool busy_erase = false;
+	uint32_t erase_addr = 0, erase_size = 0;
+	uint64_t suspend_at = 0;    // time the erase stopped, 0 if not suspended
+	uint64_t remaining = 0;     // erase time left when suspended
+};
+
+// SPI NAND flash like the Winbond W25N01G: JEDEC ID 0x9F, status
+// registers 0x05/0x01, write enable 0x06/0x04, page data read 0x13 to the
+// page buffer, read 0x03/0x0B from it in buffered mode, program data load
+// 0x02/0x84, program execute 0x10, block erase 0xD8, bad block table 0xA5,
+// reset 0xFF, and die select 0xC2 on stacked chips like the W25M02.  Each
+// die has its own page buffer and status registers, and its blocks start
+// out write protected.  Page addresses past 16 bits go in the byte before
+// them.
+class SimNAND : public SPIClass::Device {
+public:
+	SimNAND(const SimChip &chip);
+	void select();
+	uint8_t transfer(uint8_t data, uint32_t clock);
+	void deselect();
+	SimCounts count = {};
+	const char *lastError = "";
+	// Each byte of the chip, page data then spare, 0xFF when erased
+	uint8_t peek(uint32_t page, uint32_t column);
+	// Pages never erased or programmed read as this, set before use
+	uint8_t unwritten = 0xFF;
+	// ECC status reported after every page data read, 1 for corrected
+	// bit errors, 2 for uncorrectable ones
+	uint8_t eccStatus = 0;
+private:
+	struct Die {
+		std::vector<uint8_t> buffer;    // page buffer, data then spare
+		uint8_t protect = 0x7C;         // 0xA0, every block locked
+		uint8_t config = 0x18;          // 0xB0, ECC on, buffered read
+		uint8_t status = 0;             // 0xC0 bits other than busy
+		uint64_t busy_until = 0;
+	};
+	void error(const char *msg) { count.errors++; lastError = msg; }
+	bool busy() { return host_now_ns() < dies[active].busy_until; }
+	uint8_t * block(uint32_t page, bool write);
+	bool pageOf(uint32_t addr, uint32_t &page);
+	uint8_t readRegister(uint8_t reg);
+	const SimChip chip;
+	const uint32_t pagebytes;       // data and spare
+	const uint32_t pagesPerBlock;
+	std::vector<std::unique_ptr<uint8_t[]>> blocks; // null until programmed
+	std::vector<bool> erased;       // a null block was erased, not unwritten
+	std::vector<uint8_t> programs;  // partial programs of each page
+	std::vector<Die> dies;
+	uint8_t active = 0;             // die selected by 0xC2
+	uint8_t cmd = 0;
+	uint32_t bytes = 0;             // sent since chip select went low
+	bool ignore = false;            // the chip ignores this command
+	uint32_t addr = 0;              // page, column, register or die
+	uint32_t addrbytes = 0;
+	uint32_t header = 0;            // command, address and dummy bytes
+	uint8_t value = 0;              // status register value written
+};
@@ -0,0 +1,225 @@
+/* LittleFS for Teensy - host build
+ *
+ * Simulated SPI NAND flash, see SimFlash.h
+ */
+
+#include "SimFlash.h"
+
+#define READ_NS      25000   // page data read with ECC on, tRD
+#define RESET_NS     5000    // reset when idle, tRST
+#define MAX_PROGRAMS 4       // partial programs of a page between erases
+
+SimNAND::SimNAND(const SimChip &chip) : chip(chip),
+	pagebytes(chip.progsize + chip.sparesize),
+	pagesPerBlock(chip.erasesize / chip.progsize),
+	blocks(chip.chipsize / chip.erasesize),
+	erased(chip.chipsize / chip.erasesize, false),
+	programs(chip.chipsize / chip.progsize, 0),
+	dies(chip.dies)
+{
+	for (Die &d : dies) d.buffer.assign(pagebytes, 0xFF);
+}
+
+uint8_t * SimNAND::block(uint32_t page, bool write)
+{
+	const uint32_t index = page / pagesPerBlock;
+	std::unique_ptr<uint8_t[]> &b = blocks[index];
+	if (!b && write) {
+		b.reset(new uint8_t[pagesPerBlock * pagebytes]);
+		memset(b.get(), erased[index] ? 0xFF : unwritten, pagesPerBlock * pagebytes);
+	}
+	return b.get();
+}
+
+uint8_t SimNAND::peek(uint32_t page, uint32_t column)
+{
+	const uint8_t *b = block(page, false);
+	if (!b) return erased[page / pagesPerBlock] ? 0xFF : unwritten;
+	return b[(page % pagesPerBlock) * pagebytes + column];
+}
+
+uint8_t SimNAND::readRegister(uint8_t reg)
+{
+	const Die &d = dies[active];
+	switch (reg & 0xF0) {
+	case 0xA0: return d.protect;
+	case 0xB0: return d.config;
+	case 0xC0: return d.status | (busy() ? 0x01 : 0);
+	}
+	error("read of an unknown status register");
+	return 0;
+}
+
+// The page a page data read, program execute or block erase is for, or
+// false if it's past the end of the selected die
+bool SimNAND::pageOf(uint32_t addr, uint32_t &page)
+{
+	const uint32_t pagesPerDie = chip.chipsize / chip.progsize / chip.dies;
+	if (addr >= pagesPerDie) {
+		error("page past the end of the die");
+		return false;
+	}
+	page = active * pagesPerDie + addr;
+	return true;
+}
+
+void SimNAND::select()
+{
+	bytes = 0;
+	ignore = false;
+	addr = 0;
+}
+
+uint8_t SimNAND::transfer(uint8_t data, uint32_t clock)
+{
+	const uint32_t i = bytes++;
+	Die &d = dies[active];
+	if (i == 0) {
+		cmd = data;
+		switch (cmd) {
+		case 0x13: case 0x10: case 0xD8:
+			addrbytes = 3; // dummy or high bits, then 16 bit page
+			header = 4;
+			break;
+		case 0x03: case 0x0B:
+			addrbytes = 2; // column, then 8 dummy clocks
+			header = 4;
+			break;
+		case 0x02: case 0x84:
+			addrbytes = 2;
+			header = 3;
+			break;
+		case 0x05: case 0x01: case 0xC2:
+			addrbytes = 1; // register or die
+			header = 2;
+			break;
+		case 0x9F: case 0xA5:
+			addrbytes = 0;
+			header = 2; // 8 dummy clocks
+			break;
+		default:
+			addrbytes = 0;
+			header = 1;
+		}
+		if (busy() && cmd != 0x05 && cmd != 0xFF) {
+			error("command while busy");
+			ignore = true;
+		} else if ((cmd == 0x02 || cmd == 0x84) && !(d.status & 0x02)) {
+			error("program data load without write enable");
+			ignore = true;
+		}
+		return 0xFF;
+	}
+	if (ignore) return 0xFF;
+	if (i <= addrbytes) {
+		addr = (addr << 8) | data;
+		return 0xFF;
+	}
+	if (i < header) return 0xFF; // dummy clocks
+	const uint32_t n = i - header; // data byte
+	const uint32_t column = (addr & 0xFFF) + n;
+	switch (cmd) {
+	case 0x9F:
+		return (n < 3) ? chip.id[n] : 0xFF;
+	case 0x05:
+		if (n == 0) count.status++;
+		return readRegister(addr);
+	case 0x01:
+		if (n == 0) value = data;
+		return 0xFF;
+	case 0x03: case 0x0B: {
+		if (n == 0 && !(d.config & 0x08)) error("continuous read mode isn't simulated");
+		uint8_t val = (column < pagebytes) ? d.buffer[column] : 0xFF;
+		// above the chip's maximum SCK, the data isn't reliable
+		if (clock > chip.maxclock) val ^= 0x01;
+		return val;
+	}
+	case 0x02: case 0x84:
+		// 0x02 sets the rest of the buffer to 0xFF, 0x84 leaves it
+		if (n == 0 && cmd == 0x02) d.buffer.assign(pagebytes, 0xFF);
+		if (column < pagebytes) d.buffer[column] = data;
+		return 0xFF;
+	case 0xA5:
+		return 0; // no bad block links
+	}
+	return 0xFF;
+}
+
+void SimNAND::deselect()
+{
+	if (ignore || bytes == 0) return;
+	const uint64_t now = host_now_ns();
+	Die &d = dies[active];
+	uint32_t page;
+	switch (cmd) {
+	case 0xFF:
+		d.status = 0;
+		d.busy_until = now + RESET_NS;
+		break;
+	case 0x06:
+		d.status |= 0x02;
+		break;
+	case 0x04:
+		d.status &= ~0x02;
+		break;
+	case 0x01:
+		if (bytes < 3) break;
+		if ((addr & 0xF0) == 0xA0) d.protect = value;
+		else if ((addr & 0xF0) == 0xB0) d.config = value;
+		else error("write to a read only status register");
+		break;
+	case 0xC2:
+		if (bytes < 2) break;
+		if (addr < dies.size()) active = addr;
+		else error("select of a die the chip doesn't have");
+		break;
+	case 0x13:
+		if (bytes < header || !pageOf(addr, page)) break;
+		for (uint32_t col=0; col < pagebytes; col++) d.buffer[col] = peek(page, col);
+		d.status = (d.status & ~0x30) | (eccStatus << 4);
+		d.busy_until = now + READ_NS;
+		count.reads++;
+		break;
+	case 0x10: {
+		if (bytes < header || !pageOf(addr, page)) break;
+		if (!(d.status & 0x02)) {
+			error("program execute without write enable");
+			break;
+		}
+		d.status &= ~(0x02 | 0x08);
+		// any block protect bit is taken to lock the whole die
+		if (d.protect & 0x78) {
+			error("program of a locked block");
+			d.status |= 0x08; // P-FAIL
+			break;
+		}
+		if (++programs[page] > MAX_PROGRAMS) error("too many partial programs of a page");
+		uint8_t *p = block(page, true) + (page % pagesPerBlock) * pagebytes;
+		for (uint32_t col=0; col < pagebytes; col++) p[col] &= d.buffer[col]; // only clears bits
+		count.progs++;
+		d.busy_until = now + (uint64_t)chip.progtime * 1000 / SIM_TYPICAL_DIVISOR;
+		break;
+	}
+	case 0xD8: {
+		if (bytes < header || !pageOf(addr, page)) break;
+		if (!(d.status & 0x02)) {
+			error("block erase without write enable");
+			break;
+		}
+		d.status &= ~(0x02 | 0x04);
+		if (d.protect & 0x78) {
+			error("erase of a locked block");
+			d.status |= 0x04; // E-FAIL
+			break;
+		}
+		const uint32_t index = page / pagesPerBlock;
+		blocks[index].reset();
+		erased[index] = true;
+		std::fill(programs.begin() + index * pagesPerBlock,
+			programs.begin() + (index + 1) * pagesPerBlock, 0);
+		count.erases++;
+		d.busy_until = now + (uint64_t)chip.erasetime * 1000 / SIM_TYPICAL_DIVISOR;
+		break;
+	}
+	}
+}
@@ -0,0 +1,203 @@
+/* LittleFS for Teensy - host build
+ *
+ * Simulated SPI NOR flash, see SimFlash.h
+ */
+
+#include "SimFlash.h"
+
+#define SECTOR_SIZE   4096
+#define SUSPEND_NS    20000     // time for an erase to suspend, tSUS
+#define READ_MAXCLOCK 50000000  // read 0x03 is slower than fast read
+
+static bool is_erase(uint8_t cmd)
+{
+	return cmd == 0x20 || cmd == 0x21 || cmd == 0x52 || cmd == 0x5C
+		|| cmd == 0xD8 || cmd == 0xDC;
+}
+
+SimNOR::SimNOR(const SimChip &chip) : chip(chip), sectors(chip.chipsize / SECTOR_SIZE)
+{
+}
+
+uint8_t * SimNOR::sector(uint32_t addr, bool write)
+{
+	std::unique_ptr<uint8_t[]> &s = sectors[(addr % chip.chipsize) / SECTOR_SIZE];
+	if (!s && write) {
+		s.reset(new uint8_t[SECTOR_SIZE]);
+		memset(s.get(), unwritten, SECTOR_SIZE);
+	}
+	return s.get();
+}
+
+uint8_t SimNOR::peek(uint32_t addr)
+{
+	const uint8_t *s = sector(addr, false);
+	return s ? s[addr % SECTOR_SIZE] : unwritten;
+}
+
+uint32_t SimNOR::eraseTime(uint32_t size)
+{
+	if (size == chip.erasesize) return chip.erasetime;
+	if (size == SECTOR_SIZE) return chip.sectortime ? chip.sectortime : 400000;
+	return (size == 32768) ? 1600000 : 2000000;
+}
+
+void SimNOR::select()
+{
+	bytes = 0;
+	ignore = false;
+	addr = 0;
+}
+
+uint8_t SimNOR::transfer(uint8_t data, uint32_t clock)
+{
+	const uint32_t i = bytes++;
+	if (i == 0) {
+		cmd = data;
+		switch (cmd) {
+		case 0x03: case 0x02: case 0x20: case 0x52: case 0xD8:
+			addrbytes = 3;
+			header = 4;
+			break;
+		case 0x13: case 0x12: case 0x21: case 0x5C: case 0xDC:
+			addrbytes = 4;
+			header = 5;
+			break;
+		case 0x0B: case 0x5A:
+			addrbytes = 3;
+			header = 5; // 8 dummy clocks
+			break;
+		case 0x0C:
+			addrbytes = 4;
+			header = 6;
+			break;
+		default:
+			addrbytes = 0;
+			header = 1;
+		}
+		if (busy() && cmd != 0x05 && cmd != 0x35 && cmd != 0x75 && cmd != 0x7A) {
+			error("command while busy");
+			ignore = true;
+		}
+		if (suspend_at && (cmd == 0x02 || cmd == 0x12 || is_erase(cmd))) {
+			error("program or erase while an erase is suspended");
+			ignore = true;
+		}
+		return 0xFF;
+	}
+	if (ignore) return 0xFF;
+	if (i <= addrbytes) {
+		addr = (addr << 8) | data;
+		return 0xFF;
+	}
+	if (i < header) return 0xFF; // dummy clocks
+	const uint32_t n = i - header; // data byte
+	switch (cmd) {
+	case 0x9F:
+		return (n < 3) ? chip.id[n] : 0;
+	case 0x05:
+		if (n == 0) count.status++;
+		return (busy() ? 0x01 : 0) | (wel ? 0x02 : 0);
+	case 0x35:
+		return suspended() ? 0x80 : 0;
+	case 0x03: case 0x13: case 0x0B: case 0x0C: {
+		if (n == 0) {
+			count.reads++;
+			if (suspend_at && addr % chip.chipsize - erase_addr < erase_size) {
+				error("read of the block being erased");
+			}
+		}
+		uint8_t val = peek(addr + n);
+		// above the chip's maximum SCK, the data isn't reliable
+		const uint32_t maxclock = (cmd == 0x0B || cmd == 0x0C) ? chip.maxclock
+			: std::min<uint32_t>(chip.maxclock, READ_MAXCLOCK);
+		if (clock > maxclock) val ^= 0x01;
+		return val;
+	}
+	case 0x02: case 0x12:
+		if (n == 0) {
+			page.assign(chip.progsize, 0xFF);
+			pagemask.assign(chip.progsize, false);
+			pagebase = (addr % chip.chipsize) & ~(chip.progsize - 1);
+		}
+		// wraps around to the start of the page
+		page[(addr + n) % chip.progsize] = data;
+		pagemask[(addr + n) % chip.progsize] = true;
+		return 0xFF;
+	case 0x5A:
+		return (addr + n < sfdp.size()) ? sfdp[addr + n] : 0xFF;
+	}
+	return 0xFF;
+}
+
+void SimNOR::deselect()
+{
+	if (ignore || bytes == 0) return;
+	const uint64_t now = host_now_ns();
+	switch (cmd) {
+	case 0x06:
+		wel = true;
+		break;
+	case 0x04:
+		wel = false;
+		break;
+	case 0x02: case 0x12:
+		if (bytes <= header) break;
+		if (!wel) {
+			error("page program without write enable");
+			break;
+		}
+		for (uint32_t col=0; col < chip.progsize; col++) {
+			if (!pagemask[col]) continue;
+			uint8_t *s = sector(pagebase + col, true);
+			s[(pagebase + col) % SECTOR_SIZE] &= page[col]; // only clears bits
+		}
+		count.progs++;
+		wel = false;
+		busy_erase = false;
+		busy_until = now + (uint64_t)chip.progtime * 1000 / SIM_TYPICAL_DIVISOR;
+		break;
+	case 0x20: case 0x21: case 0x52: case 0x5C: case 0xD8: case 0xDC: {
+		if (bytes < header) {
+			error("erase without a whole address");
+			break;
+		}
+		if (!wel) {
+			error("erase without write enable");
+			break;
+		}
+		const uint32_t size = (cmd == 0x20 || cmd == 0x21) ? 4096
+			: (cmd == 0x52 || cmd == 0x5C) ? 32768 : 65536;
+		if (size == SECTOR_SIZE && chip.nosector) {
+			error("4K erase on a chip without it");
+			break;
+		}
+		erase_addr = (addr % chip.chipsize) & ~(size - 1);
+		erase_size = size;
+		for (uint32_t a=erase_addr; a < erase_addr + size; a += SECTOR_SIZE) {
+			memset(sector(a, true), 0xFF, SECTOR_SIZE);
+		}
+		count.erases++;
+		wel = false;
+		busy_erase = true;
+		busy_until = now + (uint64_t)eraseTime(size) * 1000 / SIM_TYPICAL_DIVISOR;
+		break;
+	}
+	case 0x75:
+		// Winbond and GigaDevice suspend erases, an erase about to end
+		// just finishes
+		if (chip.id[0] != 0xEF && chip.id[0] != 0xC8) break;
+		if (!busy() || !busy_erase || suspend_at) break;
+		if (busy_until <= now + SUSPEND_NS) break;
+		suspend_at = now + SUSPEND_NS;
+		remaining = busy_until - suspend_at;
+		busy_until = suspend_at;
+		count.suspends++;
+		break;
+	case 0x7A:
+		if (!suspend_at) break;
+		busy_until = std::max(now, suspend_at) + remaining;
+		suspend_at = 0;
+		break;
+	}
+}
@@ -0,0 +1,119 @@
+/* LittleFS for Teensy - host build
+ *
+ * Runs the Benchmark example on Linux.  The Makefile builds it once for
+ * each media type, selected by the same BENCH_ defines as the sketch.
+ * The output is the sketch's, a "LittleFS Benchmark" line then the JSON.
+ * bench_nor and bench_nand run the LittleFS_SPIFlash and LittleFS_SPINAND
+ * drivers on a simulated chip from the driver's own table, named on the
+ * command line.
+ *
+ * usage: bench_ram [-d] [-t trace.bin]
+ *        bench_nor [-d] [-t trace.bin] [-l] [chip]
+ *        bench_nand [-d] [-t trace.bin] [-l] [chip]
+ *   -d  leave the host's run time out, so the results only depend on the
+ *       simulated hardware and are the same on every run
+ *   -t  save a block operation trace of the run, in the TraceRecord
+ *       example's format, for the replay tool
+ *   -l  list the simulated chips
+ */
+
+#define BENCH_HOST
+#include <Arduino.h>
+#include <unistd.h>
+#include "SimFlash.h"
+
+// the sketch's functions, which the Arduino IDE would declare
+void benchSequentialWrite();
+void benchSequentialRead();
+void benchRandomRead();
+void benchAppend();
+void benchChurn();
+void benchDirList();
+void benchMount();
+void benchCrc();
+
+#include "../../examples/Benchmark/Benchmark.ino"
+
+#define TRACE_SIZE  (1 << 21)  // records, the whole run fits
+
+// Save the trace with the TraceRecord example's header
+static bool saveTrace(const char *filename, LittleFS_TraceRecord *trace)
+{
+	FILE *f = fopen(filename, "wb");
+	if (!f) {
+		perror(filename);
+		return false;
+	}
+	const lfs_config *c = myfs.cfg();
+	const uint32_t header[4] = {0x5453464C, sizeof(LittleFS_TraceRecord),
+		c->block_size, c->block_count}; // "LFST"
+	fwrite(header, sizeof(header), 1, f);
+	const uint32_t n = myfs.readTrace(trace, TRACE_SIZE);
+	fwrite(trace, sizeof(LittleFS_TraceRecord), n, f);
+	fclose(f);
+	if (myfs.traceLost()) {
+		fprintf(stderr, "%s: the oldest %u records were lost\n", filename, myfs.traceLost());
+	}
+	return true;
+}
+
+#if defined(BENCH_SPI_FLASH)
+#define SIM_CHIPS  simNORChip
+typedef SimNOR sim_t;
+#elif defined(BENCH_SPI_NAND)
+#define SIM_CHIPS  simNANDChip
+typedef SimNAND sim_t;
+#endif
+
+int main(int argc, char **argv)
+{
+	const char *tracefile = nullptr;
+	int opt;
+	while ((opt = getopt(argc, argv, "dt:l")) != -1) {
+		switch (opt) {
+		case 'd':
+			host_cpu_time(false);
+			break;
+		case 't':
+			tracefile = optarg;
+			break;
+#if defined(SIM_CHIPS)
+		case 'l': {
+			SimChip chip;
+			for (unsigned int i=0; SIM_CHIPS(i, chip); i++) printf("%s\n", chip.pn);
+			return 0;
+		}
+#endif
+		default:
+			fprintf(stderr, "usage: %s [-d] [-t trace.bin] [-l] [chip]\n", argv[0]);
+			return 2;
+		}
+	}
+#if defined(SIM_CHIPS)
+	SimChip chip;
+	if (!simFindChip(SIM_CHIPS, (optind < argc) ? argv[optind] : nullptr, chip)) {
+		fprintf(stderr, "%s: unknown chip %s, -l lists them\n", argv[0], argv[optind]);
+		return 2;
+	}
+	sim_t sim(chip);
+	SPI.attach(chipSelect, &sim);
+#endif
+	std::vector<LittleFS_TraceRecord> trace;
+	if (tracefile) {
+		trace.resize(TRACE_SIZE);
+		myfs.beginTrace(trace.data(), TRACE_SIZE);
+	}
+	setup();
+	Serial.flush();
+	if (tracefile) {
+		myfs.endTrace();
+		if (!saveTrace(tracefile, trace.data())) return 1;
+	}
+#if defined(SIM_CHIPS)
+	if (sim.count.errors) {
+		fprintf(stderr, "%s: %u chip errors, last: %s\n", chip.pn, sim.count.errors, sim.lastError);
+		return 1;
+	}
+#endif
+	return myfs.mediaPresent() ? 0 : 1;
+}
@@ -0,0 +1,249 @@
+/* LittleFS for Teensy - host build
+ *
+ * Checks the drivers on the simulated chips: files written through the
+ * library read back the same, after mounting again and after a new begin(),
+ * and the driver never sends a command the chip would refuse.  Each NOR chip
+ * is checked with its usual erase size and 4K sectors, with and without
+ * deferred waits, and NAND chips also with bit errors their ECC corrected.
+ * The chips start out used, so every block needs erasing.
+ *
+ * usage: check [chip]
+ */
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include "SimFlash.h"
+
+#define CS_PIN  6
+
+static unsigned int failures = 0;
+
+static void fail(const char *media, const char *what)
+{
+	printf("FAIL %s: %s\n", media, what);
+	failures++;
+}
+
+// Contents of each test file, different for every file and offset
+static uint8_t pattern(uint32_t seed, uint32_t offset)
+{
+	return (seed * 131 + offset * 7 + (offset >> 8)) & 0xFF;
+}
+
+static const struct {
+	const char *name;
+	uint32_t size;
+} files[] = {
+	{"empty.txt", 0},
+	{"small.txt", 100},
+	{"dir/page.bin", 256},
+	{"dir/medium.bin", 5000},
+	{"large.bin", 150000},
+};
+#define NUM_FILES  (sizeof(files) / sizeof(files[0]))
+
+static bool writeFile(LittleFS &fs, const char *name, uint32_t size, uint32_t seed)
+{
+	uint8_t buf[700]; // not a multiple of the page size
+	File f = fs.open(name, FILE_WRITE_BEGIN);
+	if (!f) return false;
+	for (uint32_t n=0; n < size; ) {
+		uint32_t len = size - n;
+		if (len > sizeof(buf)) len = sizeof(buf);
+		for (uint32_t i=0; i < len; i++) buf[i] = pattern(seed, n + i);
+		if (f.write(buf, len) != len) return false;
+		n += len;
+	}
+	f.close();
+	return true;
+}
+
+static bool verifyFile(LittleFS &fs, const char *name, uint32_t size, uint32_t seed)
+{
+	uint8_t buf[900];
+	File f = fs.open(name);
+	if (!f || f.size() != size) return false;
+	for (uint32_t n=0; n < size; ) {
+		uint32_t len = size - n;
+		if (len > sizeof(buf)) len = sizeof(buf);
+		if (f.read(buf, len) != len) return false;
+		for (uint32_t i=0; i < len; i++) {
+			if (buf[i] != pattern(seed, n + i)) return false;
+		}
+		n += len;
+	}
+	return true;
+}
+
+static bool verifyAll(LittleFS &fs)
+{
+	for (unsigned int i=0; i < NUM_FILES; i++) {
+		if (!verifyFile(fs, files[i].name, files[i].size, i)) return false;
+	}
+	return !fs.exists("removed.bin");
+}
+
+// Mount again without formatting, as the Benchmark example does
+template <class media_t>
+class CheckFS : public media_t
+{
+public:
+	bool remount() {
+		if (!this->mounted) return false;
+		lfs_unmount(&this->lfs);
+		this->mounted = false;
+		if (lfs_mount(&this->lfs, &this->config) < 0) return false;
+		this->mounted = true;
+		return true;
+	}
+	struct lfs_config * cfg() { return &this->config; }
+	uint32_t eraseTime() { return this->erase_time_us; }
+};
+
+// Erase a block and program it twice, with deferred waits the program
+// starts while the erase is still running.  The second erase mustn't be
+// skipped, or the second program lands on the first one's data.
+static bool eraseProgTwice(struct lfs_config *c, lfs_block_t block)
+{
+	uint8_t buf[256], check[256];
+	for (int n=0; n < 2; n++) {
+		for (unsigned int i=0; i < sizeof(buf); i++) buf[i] = pattern(n, i);
+		if (c->erase(c, block) || c->prog(c, block, 0, buf, sizeof(buf))) return false;
+	}
+	if (c->sync(c) || c->read(c, block, 0, check, sizeof(check))) return false;
+	return memcmp(buf, check, sizeof(buf)) == 0;
+}
+
+// Erase a block, then keep reading others for longer than the erase may
+// take.  On chips which suspend erases for reads, the erase only runs
+// between the reads, and the time it spent suspended mustn't make it time
+// out.
+static bool readWhileErasing(struct lfs_config *c, lfs_block_t block, uint32_t timeout_us)
+{
+	static uint8_t buf[65536]; // long reads, so the erase is mostly suspended
+	if (c->erase(c, block)) return false;
+	const uint64_t end = host_now_ns() + (uint64_t)timeout_us * 1500;
+	while (host_now_ns() < end) {
+		if (c->read(c, 0, 0, buf, sizeof(buf))) return false;
+	}
+	return c->sync(c) == 0;
+}
+
+// Write, rewrite and remove files, and read them back, then after mounting
+// again
+template <class media_t>
+static void checkFiles(CheckFS<media_t> &fs, const char *media)
+{
+	fs.mkdir("dir");
+	for (unsigned int i=0; i < NUM_FILES; i++) {
+		if (!writeFile(fs, files[i].name, files[i].size, i)) fail(media, "write");
+	}
+	// rewrite and remove, so blocks are erased again
+	if (!writeFile(fs, "removed.bin", 70000, 99)) fail(media, "write");
+	if (!writeFile(fs, "large.bin", files[4].size, 4)) fail(media, "rewrite");
+	if (!fs.remove("removed.bin")) fail(media, "remove");
+	if (!verifyAll(fs)) fail(media, "read back");
+	if (!fs.remount() || !verifyAll(fs)) fail(media, "read back after mounting again");
+}
+
+template <class sim_t>
+static void checkErrors(sim_t &sim, const char *media)
+{
+	if (sim.count.errors) {
+		char what[120];
+		snprintf(what, sizeof(what), "%u chip errors, last: %s",
+			sim.count.errors, sim.lastError);
+		fail(media, what);
+	}
+	printf("%-40s %6u reads %6u progs %5u erases %4u suspends\n", media,
+		sim.count.reads, sim.count.progs, sim.count.erases, sim.count.suspends);
+}
+
+static void checkNOR(const SimChip &chip, uint32_t blockSize, bool deferred)
+{
+	char media[80];
+	snprintf(media, sizeof(media), "%s, %s blocks%s", chip.pn,
+		blockSize ? "4K" : "usual", deferred ? ", deferred" : "");
+	SimNOR sim(chip);
+	sim.unwritten = 0x5A;
+	SPI.attach(CS_PIN, &sim);
+	CheckFS<LittleFS_SPIFlash> fs;
+	if (!fs.begin(CS_PIN, SPI, 0, blockSize)) {
+		fail(media, "begin");
+		return;
+	}
+	fs.setDeferredWait(deferred);
+	// the last block, which a new filesystem doesn't use
+	if (!eraseProgTwice(fs.cfg(), fs.cfg()->block_count - 1)) {
+		fail(media, "erase and program the same block twice");
+	}
+	// 4K sectors erase quickly enough to read through the whole timeout
+	if (deferred && fs.cfg()->block_size == 4096
+	  && !readWhileErasing(fs.cfg(), fs.cfg()->block_count - 1, fs.eraseTime())) {
+		fail(media, "erase with reads suspending it");
+	}
+	checkFiles(fs, media);
+	fs.setDeferredWait(false);
+
+	LittleFS_SPIFlash fs2;
+	if (!fs2.begin(CS_PIN, SPI, 0, blockSize) || !verifyAll(fs2)) {
+		fail(media, "read back after begin");
+	}
+	const uint32_t clock = fs2.calibrateClock();
+	if (!clock || clock > chip.maxclock) fail(media, "calibrateClock");
+	if (!verifyAll(fs2)) fail(media, "read back after calibrateClock");
+	checkErrors(sim, media);
+}
+
+static void checkNAND(const SimChip &chip)
+{
+	SimNAND sim(chip);
+	sim.unwritten = 0x5A;
+	SPI.attach(CS_PIN, &sim);
+	CheckFS<LittleFS_SPINAND> fs;
+	if (!fs.begin(CS_PIN, SPI)) {
+		fail(chip.pn, "begin");
+		return;
+	}
+	checkFiles(fs, chip.pn);
+
+	LittleFS_SPINAND fs2;
+	if (!fs2.begin(CS_PIN, SPI) || !verifyAll(fs2)) {
+		fail(chip.pn, "read back after begin");
+	}
+	const uint32_t clock = fs2.calibrateClock();
+	if (!clock || clock > chip.maxclock) fail(chip.pn, "calibrateClock");
+	if (!verifyAll(fs2)) fail(chip.pn, "read back after calibrateClock");
+	// corrected bit errors still read back
+	sim.eccStatus = 1;
+	if (!verifyAll(fs2)) fail(chip.pn, "read back with corrected bit errors");
+	sim.eccStatus = 0;
+	checkErrors(sim, chip.pn);
+}
+
+int main(int argc, char **argv)
+{
+	const char *only = (argc > 1) ? argv[1] : nullptr;
+	host_cpu_time(false);
+	SimChip chip;
+	unsigned int count = 0;
+	for (unsigned int i=0; simNORChip(i, chip); i++) {
+		if (only && strcmp(chip.pn, only) != 0) continue;
+		for (int deferred=0; deferred < 2; deferred++) {
+			checkNOR(chip, 0, deferred);
+			if (chip.erasesize != 4096 && !chip.nosector) checkNOR(chip, 4096, deferred);
+		}
+		count++;
+	}
+	for (unsigned int i=0; simNANDChip(i, chip); i++) {
+		if (only && strcmp(chip.pn, only) != 0) continue;
+		checkNAND(chip);
+		count++;
+	}
+	if (!count) {
+		fprintf(stderr, "%s: unknown chip %s\n", argv[0], only);
+		return 2;
+	}
+	printf("%u chips, %u failures\n", count, failures);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,30 @@
+/* LittleFS for Teensy - host build
+ *
+ * The library's LittleFS_NAND.cpp, with the chips of its known_chips
+ * table for the simulated NAND flash, like chips_nor.cpp.
+ */
+
+#include "../../src/LittleFS_NAND.cpp"
+#include "SimFlash.h"
+
+bool simNANDChip(unsigned int index, SimChip &chip)
+{
+	const unsigned int numchips = sizeof(known_chips) / sizeof(struct nand_chipinfo);
+	if (index >= numchips) return false;
+	const struct nand_chipinfo *info = known_chips + index;
+	const uint32_t id = (info->id[0] << 16) | (info->id[1] << 8) | info->id[2];
+	memset(&chip, 0, sizeof(chip));
+	chip.pn = info->pn;
+	memcpy(chip.id, info->id, 3);
+	chip.chipsize = info->chipsize + reservedBBMBlocks * info->erasesize;
+	chip.progsize = info->progsize;
+	chip.erasesize = info->erasesize;
+	chip.progtime = info->progtime;
+	chip.erasetime = info->erasetime;
+	chip.nosector = true;
+	chip.maxclock = info->maxmhz * 1000000;
+	// as LittleFS_SPINAND::begin()
+	chip.sparesize = (id == W25N02) ? 128 : 64;
+	chip.dies = (id == W25M02) ? 2 : 1;
+	return true;
+}
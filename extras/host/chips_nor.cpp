@@ -0,0 +1,42 @@
+/* LittleFS for Teensy - host build
+ *
+ * The library's LittleFS.cpp, with the NOR chips of its known_chips
+ * table for the simulated flash.  Building the table's own file keeps the
+ * simulated chips the same as the ones the driver knows.
+ */
+
+#include "../../src/LittleFS.cpp"
+#include "SimFlash.h"
+
+bool simNORChip(unsigned int index, SimChip &chip)
+{
+	const unsigned int numchips = sizeof(known_chips) / sizeof(struct chipinfo);
+	for (unsigned int i=0; i < numchips; i++) {
+		const struct chipinfo *info = known_chips + i;
+		if (!info->erasecmd) continue; // F-RAM
+		if (index-- > 0) continue;
+		memset(&chip, 0, sizeof(chip));
+		chip.pn = info->pn;
+		memcpy(chip.id, info->id, 3);
+		chip.addrbits = info->addrbits;
+		chip.chipsize = info->chipsize;
+		chip.progsize = info->progsize;
+		chip.erasesize = info->erasesize;
+		chip.progtime = info->progtime;
+		chip.erasetime = info->erasetime;
+		chip.sectortime = info->sectortime;
+		chip.nosector = info->nosector;
+		chip.maxclock = chip_clock(info);
+		chip.dies = 1;
+		return true;
+	}
+	return false;
+}
+
+bool simFindChip(bool (*list)(unsigned int, SimChip &), const char *pn, SimChip &chip)
+{
+	for (unsigned int i=0; list(i, chip); i++) {
+		if (!pn || strcmp(chip.pn, pn) == 0) return true;
+	}
+	return false;
+}
@@ -0,0 +1,233 @@
+/* LittleFS for Teensy - host build
+ *
+ * Replays a block operation trace, saved by the TraceRecord example or by
+ * bench -t, through one of the library's drivers: the RAM disk, or the
+ * SPI NOR or NAND driver on a simulated chip.  Each operation goes to the
+ * same byte address on the replay media, split at its block boundaries
+ * (page boundaries for NAND, which reads and programs one page at a time),
+ * and programs write a pattern.  An erase erases every block it overlaps,
+ * so media with larger blocks than the trace erase more often.
+ *
+ * Prints the TraceReplay example's summary, with the time each kind of
+ * operation took on the replay media, and a heatmap of the media's blocks
+ * as CSV.  Commands a simulated chip refused, such as more partial
+ * programs of a NAND page than it allows when the trace's programs are
+ * smaller than a page, are printed and make the exit status 1.
+ *
+ * usage: replay [-d] [-m ram|nor|nand] [-c chip] trace.bin
+ *   -d  leave the host's run time out, as bench -d does
+ *   -m  replay media, ram by default
+ *   -c  simulated chip, the first one of the driver's table by default
+ */
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <unistd.h>
+#include "SimFlash.h"
+
+#define CS_PIN      6
+#define TRACE_MAGIC 0x5453464C  // "LFST"
+
+// config is protected in LittleFS, the replay calls it directly
+template <class media_t>
+class ReplayFS : public media_t
+{
+public:
+	struct lfs_config * cfg() { return &this->config; }
+};
+
+static const char *opname[] = {"", "read", "prog", "erase", "sync"};
+
+static struct {
+	uint32_t count;
+	uint64_t bytes;
+	uint64_t recorded_us;
+	uint64_t replayed_ns;
+} summary[5];
+
+// per-block operation counts on the replay media
+struct heat {
+	uint32_t reads;
+	uint32_t progs;
+	uint32_t erases;
+};
+
+static uint32_t trace_block_size, trace_block_count;
+static std::vector<LittleFS_TraceRecord> records;
+
+static bool readTrace(const char *filename)
+{
+	FILE *f = fopen(filename, "rb");
+	if (!f) {
+		perror(filename);
+		return false;
+	}
+	uint32_t header[4];
+	if (fread(header, sizeof(header), 1, f) != 1 || header[0] != TRACE_MAGIC
+	  || header[1] != sizeof(LittleFS_TraceRecord)) {
+		fprintf(stderr, "%s is not a LittleFS trace\n", filename);
+		fclose(f);
+		return false;
+	}
+	trace_block_size = header[2];
+	trace_block_count = header[3];
+	LittleFS_TraceRecord r;
+	while (fread(&r, sizeof(r), 1, f) == 1) records.push_back(r);
+	fclose(f);
+	return true;
+}
+
+// Replay every record on the media, reads and programs split into pieces
+// of at most split bytes which don't cross a multiple of it
+static int replay(struct lfs_config *c, uint32_t split)
+{
+	std::vector<heat> heatmap(c->block_count);
+	std::vector<uint8_t> buf(split);
+	uint32_t errors = 0;
+	for (const LittleFS_TraceRecord &r : records) {
+		if (r.op < LITTLEFS_TRACE_READ || r.op > LITTLEFS_TRACE_SYNC) continue;
+		summary[r.op].count++;
+		summary[r.op].bytes += r.size;
+		summary[r.op].recorded_us += r.duration_us;
+		const uint64_t addr = (uint64_t)r.block * trace_block_size + r.offset;
+		const uint64_t begin_ns = host_now_ns();
+		int err = 0;
+		if (r.op == LITTLEFS_TRACE_READ || r.op == LITTLEFS_TRACE_PROG) {
+			for (uint64_t a=addr; a < addr + r.size && !err; ) {
+				const lfs_block_t block = a / c->block_size;
+				const lfs_off_t offset = a % c->block_size;
+				uint32_t len = split - (a % split);
+				if (len > addr + r.size - a) len = addr + r.size - a;
+				if (r.op == LITTLEFS_TRACE_READ) {
+					err = c->read(c, block, offset, buf.data(), len);
+					heatmap[block].reads++;
+				} else {
+					for (uint32_t i=0; i < len; i++) buf[i] = (a + i) * 7;
+					err = c->prog(c, block, offset, buf.data(), len);
+					heatmap[block].progs++;
+				}
+				a += len;
+			}
+		} else if (r.op == LITTLEFS_TRACE_ERASE) {
+			const lfs_block_t first = addr / c->block_size;
+			const lfs_block_t last = (addr + trace_block_size - 1) / c->block_size;
+			for (lfs_block_t block=first; block <= last && !err; block++) {
+				err = c->erase(c, block);
+				heatmap[block].erases++;
+			}
+		} else {
+			err = c->sync(c);
+		}
+		if (err) errors++;
+		summary[r.op].replayed_ns += host_now_ns() - begin_ns;
+	}
+
+	printf("replay: block size %u, block count %u, %u returned errors\n",
+		c->block_size, c->block_count, errors);
+	printf("\nop,count,bytes,recorded_us,replayed_us\n");
+	for (int op=LITTLEFS_TRACE_READ; op <= LITTLEFS_TRACE_SYNC; op++) {
+		printf("%s,%u,%llu,%llu,%llu\n", opname[op], summary[op].count,
+			(unsigned long long)summary[op].bytes,
+			(unsigned long long)summary[op].recorded_us,
+			(unsigned long long)(summary[op].replayed_ns / 1000));
+	}
+	printf("\nblock,reads,progs,erases\n");
+	for (uint32_t block=0; block < c->block_count; block++) {
+		const heat &h = heatmap[block];
+		if (h.reads || h.progs || h.erases) {
+			printf("%u,%u,%u,%u\n", block, h.reads, h.progs, h.erases);
+		}
+	}
+	return errors;
+}
+
+// Replay media must hold every block of the trace
+static bool fits(struct lfs_config *c, const char *name)
+{
+	if ((uint64_t)c->block_size * c->block_count
+	  >= (uint64_t)trace_block_size * trace_block_count) {
+		printf("replay media: %s\n", name);
+		return true;
+	}
+	fprintf(stderr, "the trace doesn't fit on %s\n", name);
+	return false;
+}
+
+template <class sim_t>
+static int simErrors(sim_t &sim, const char *pn)
+{
+	printf("\nchip,reads,progs,erases,status,suspends,errors\n");
+	printf("%s,%u,%u,%u,%u,%u,%u\n", pn, sim.count.reads, sim.count.progs,
+		sim.count.erases, sim.count.status, sim.count.suspends, sim.count.errors);
+	if (!sim.count.errors) return 0;
+	fprintf(stderr, "%s: %u chip errors, last: %s\n", pn, sim.count.errors, sim.lastError);
+	return 1;
+}
+
+int main(int argc, char **argv)
+{
+	const char *media = "ram";
+	const char *pn = nullptr;
+	int opt;
+	while ((opt = getopt(argc, argv, "dm:c:")) != -1) {
+		switch (opt) {
+		case 'd':
+			host_cpu_time(false);
+			break;
+		case 'm':
+			media = optarg;
+			break;
+		case 'c':
+			pn = optarg;
+			break;
+		default:
+			optind = argc;
+		}
+	}
+	if (optind != argc - 1) {
+		fprintf(stderr, "usage: %s [-d] [-m ram|nor|nand] [-c chip] trace.bin\n", argv[0]);
+		return 2;
+	}
+	if (!readTrace(argv[optind])) return 2;
+	printf("LittleFS Trace Replay\n");
+	printf("trace: block size %u, block count %u, %u records\n",
+		trace_block_size, trace_block_count, (unsigned int)records.size());
+
+	SimChip chip;
+	if (strcmp(media, "ram") == 0) {
+		// at least the RAM disk's 1 MByte for 2K blocks
+		const uint32_t size = std::max<uint64_t>((uint64_t)trace_block_size * trace_block_count,
+			1024 * 1024 + 256);
+		std::vector<uint8_t> disk(size);
+		ReplayFS<LittleFS_RAM> fs;
+		if (!fs.begin(disk.data(), size)) return 2;
+		if (!fits(fs.cfg(), fs.getMediaName())) return 2;
+		return replay(fs.cfg(), fs.cfg()->block_size) ? 1 : 0;
+	} else if (strcmp(media, "nor") == 0) {
+		if (!simFindChip(simNORChip, pn, chip)) {
+			fprintf(stderr, "unknown NOR chip %s\n", pn);
+			return 2;
+		}
+		SimNOR sim(chip);
+		SPI.attach(CS_PIN, &sim);
+		ReplayFS<LittleFS_SPIFlash> fs;
+		if (!fs.begin(CS_PIN, SPI)) return 2;
+		if (!fits(fs.cfg(), chip.pn)) return 2;
+		const int errors = replay(fs.cfg(), fs.cfg()->block_size);
+		return (simErrors(sim, chip.pn) || errors) ? 1 : 0;
+	} else if (strcmp(media, "nand") == 0) {
+		if (!simFindChip(simNANDChip, pn, chip)) {
+			fprintf(stderr, "unknown NAND chip %s\n", pn);
+			return 2;
+		}
+		SimNAND sim(chip);
+		SPI.attach(CS_PIN, &sim);
+		ReplayFS<LittleFS_SPINAND> fs;
+		if (!fs.begin(CS_PIN, SPI)) return 2;
+		if (!fits(fs.cfg(), chip.pn)) return 2;
+		const int errors = replay(fs.cfg(), fs.cfg()->prog_size);
+		return (simErrors(sim, chip.pn) || errors) ? 1 : 0;
+	}
+	fprintf(stderr, "unknown media %s\n", media);
+	return 2;
+}
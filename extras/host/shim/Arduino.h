@@ -0,0 +1,144 @@
+/* LittleFS for Teensy - host build
+ *
+ * Just enough of the Teensy core for the library and the Benchmark
+ * example to build and run on Linux.  Time is the host's own run time
+ * plus the time simulated hardware has taken, see host.cpp.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdarg.h>
+
+typedef bool boolean;
+
+#define PROGMEM
+#define FLASHMEM
+#define DMAMEM
+#define EXTMEM
+#define F(s) (s)
+
+#define LOW      0
+#define HIGH     1
+#define INPUT    0
+#define OUTPUT   1
+#define DEC      10
+#define HEX      16
+
+#define A0       14
+#define A1       15
+#define A2       16
+
+// Time
+uint32_t micros();
+uint32_t millis();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void delayNanoseconds(uint32_t ns);
+void yield();
+
+// Simulated hardware adds its time to the clock
+void host_advance_ns(uint64_t ns);
+uint64_t host_now_ns();
+// false to leave the host's own run time out of micros(), so results only
+// depend on the simulated hardware and are the same on every run
+void host_cpu_time(bool enable);
+
+class elapsedMicros {
+public:
+	elapsedMicros(uint32_t val=0) { us = micros() - val; }
+	operator uint32_t() const { return micros() - us; }
+	elapsedMicros & operator = (uint32_t val) { us = micros() - val; return *this; }
+private:
+	uint32_t us;
+};
+
+class elapsedMillis {
+public:
+	elapsedMillis(uint32_t val=0) { ms = millis() - val; }
+	operator uint32_t() const { return millis() - ms; }
+	elapsedMillis & operator = (uint32_t val) { ms = millis() - val; return *this; }
+private:
+	uint32_t ms;
+};
+
+// Pins, chip select pins are connected to simulated chips by SPIClass
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+inline void digitalWriteFast(uint8_t pin, uint8_t val) { digitalWrite(pin, val); }
+int analogRead(uint8_t pin);
+
+long random(long max);
+long random(long min, long max);
+void randomSeed(uint32_t seed);
+
+size_t strlcpy(char *dst, const char *src, size_t size);
+
+inline void * extmem_malloc(size_t size) { return malloc(size); }
+inline void extmem_free(void *ptr) { free(ptr); }
+
+// Output
+class Print {
+public:
+	virtual ~Print() { }
+	virtual size_t write(uint8_t c) = 0;
+	virtual size_t write(const uint8_t *buf, size_t size) {
+		size_t n = 0;
+		while (size--) n += write(*buf++);
+		return n;
+	}
+	size_t write(const char *str) { return write((const uint8_t *)str, strlen(str)); }
+	virtual void flush() { }
+	size_t print(const char *s) { return write(s); }
+	size_t print(char c) { return write((uint8_t)c); }
+	size_t print(long n, int base=DEC) { return printf(base == HEX ? "%lX" : "%ld", n); }
+	size_t print(unsigned long n, int base=DEC) { return printf(base == HEX ? "%lX" : "%lu", n); }
+	size_t print(int n, int base=DEC) { return print((long)n, base); }
+	size_t print(unsigned int n, int base=DEC) { return print((unsigned long)n, base); }
+	size_t print(double n, int digits=2) { return printf("%.*f", digits, n); }
+	size_t println() { return write('\n'); }
+	template <typename T> size_t println(T val) { return print(val) + println(); }
+	template <typename T> size_t println(T val, int fmt) { return print(val, fmt) + println(); }
+	int printf(const char *format, ...) __attribute__ ((format (printf, 2, 3)));
+};
+
+class Stream : public Print {
+public:
+	virtual int available() { return 0; }
+	virtual int read() { return -1; }
+	virtual int peek() { return -1; }
+};
+
+// Serial writes to stdout
+class usb_serial_class : public Stream {
+public:
+	void begin(long baud) { }
+	operator bool() { return true; }
+	size_t write(uint8_t c) { return fwrite(&c, 1, 1, stdout); }
+	size_t write(const uint8_t *buf, size_t size) { return fwrite(buf, 1, size, stdout); }
+	using Print::write;
+	void flush() { fflush(stdout); }
+};
+extern usb_serial_class Serial;
+
+// Real time clock, for file timestamps
+typedef struct {
+	uint8_t sec;
+	uint8_t min;
+	uint8_t hour;
+	uint8_t wday;
+	uint8_t mday;
+	uint8_t mon;
+	uint8_t year;
+} DateTimeFields;
+void breakTime(uint32_t time, DateTimeFields &tm);
+uint32_t makeTime(const DateTimeFields &tm);
+
+class teensy3_clock_class {
+public:
+	static unsigned long get();
+};
+extern teensy3_clock_class Teensy3Clock;
@@ -0,0 +1,53 @@
+/* LittleFS for Teensy - host build
+ *
+ * SPIClass, with simulated chips in place of the hardware.  A chip is
+ * attached to a chip select pin, and sees every byte sent while that pin
+ * is low.  Each byte adds its time at the transaction's SCK to the clock.
+ */
+
+#pragma once
+#include <Arduino.h>
+
+#define MSBFIRST   1
+#define SPI_MODE0  0
+
+class SPISettings {
+public:
+	SPISettings(uint32_t clock=4000000, uint8_t bitOrder=MSBFIRST, uint8_t dataMode=SPI_MODE0)
+	  : clock(clock) { }
+	uint32_t clock;
+};
+
+class SPIClass {
+public:
+	// A simulated chip on the bus
+	class Device {
+	public:
+		virtual ~Device() { }
+		virtual void select() = 0;      // chip select went low
+		virtual uint8_t transfer(uint8_t data, uint32_t clock) = 0;
+		virtual void deselect() = 0;    // chip select went high
+	};
+	constexpr SPIClass() { }
+	void attach(uint8_t cspin, Device *device);
+	void begin() { }
+	void beginTransaction(SPISettings settings) { clock = settings.clock; }
+	void endTransaction() { }
+	uint8_t transfer(uint8_t data);
+	uint16_t transfer16(uint16_t data) {
+		const uint8_t hi = transfer(data >> 8);
+		return (hi << 8) | transfer(data & 0xFF);
+	}
+	void transfer(void *buf, size_t count) { transfer(buf, buf, count); }
+	void transfer(const void *txbuf, void *rxbuf, size_t count);
+	uint32_t transactions = 0;  // chip selects, for the Benchmark example
+private:
+	friend void digitalWrite(uint8_t pin, uint8_t val);
+	uint32_t clock = 4000000;
+	Device *selected = nullptr;
+	uint32_t fraction_ps = 0;   // bus time not yet added to the clock
+};
+
+extern SPIClass SPI;
+extern SPIClass SPI1;
+extern SPIClass SPI2;
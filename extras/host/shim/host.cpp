@@ -0,0 +1,205 @@
+/* LittleFS for Teensy - host build
+ *
+ * The clock is the host's own run time, so the numbers for littlefs and
+ * the library are those of the machine running them, plus the time the
+ * simulated chips took.  yield() and delays only add to the simulated
+ * time, so waiting for a chip takes no real time.
+ */
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <time.h>
+#include <chrono>
+
+usb_serial_class Serial;
+teensy3_clock_class Teensy3Clock;
+SPIClass SPI;
+SPIClass SPI1;
+SPIClass SPI2;
+
+static uint64_t simulated_ns = 0;
+static bool use_cpu_time = true;
+static const auto start_time = std::chrono::steady_clock::now();
+
+uint64_t host_now_ns()
+{
+	uint64_t ns = simulated_ns;
+	if (use_cpu_time) {
+		ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now() - start_time).count();
+	}
+	return ns;
+}
+
+void host_advance_ns(uint64_t ns)
+{
+	simulated_ns += ns;
+}
+
+void host_cpu_time(bool enable)
+{
+	if (!enable && use_cpu_time) simulated_ns = host_now_ns(); // never runs backwards
+	use_cpu_time = enable;
+}
+
+uint32_t micros()
+{
+	return host_now_ns() / 1000;
+}
+
+uint32_t millis()
+{
+	return host_now_ns() / 1000000;
+}
+
+void delay(uint32_t ms)
+{
+	simulated_ns += (uint64_t)ms * 1000000;
+}
+
+void delayMicroseconds(uint32_t us)
+{
+	simulated_ns += (uint64_t)us * 1000;
+}
+
+void delayNanoseconds(uint32_t ns)
+{
+	simulated_ns += ns;
+}
+
+// Code waiting for a chip calls yield(), let the chip's time pass
+void yield()
+{
+	simulated_ns += 1000;
+}
+
+// Chip select pins
+static struct {
+	SPIClass *port;
+	SPIClass::Device *device;
+	bool low;
+} pins[256];
+
+void SPIClass::attach(uint8_t cspin, Device *device)
+{
+	pins[cspin].port = this;
+	pins[cspin].device = device;
+	pins[cspin].low = false;
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+}
+
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+	SPIClass *port = pins[pin].port;
+	if (!port || pins[pin].low == (val == LOW)) return;
+	pins[pin].low = (val == LOW);
+	if (val == LOW) {
+		port->selected = pins[pin].device;
+		port->transactions++;
+		port->selected->select();
+	} else {
+		pins[pin].device->deselect();
+		if (port->selected == pins[pin].device) port->selected = nullptr;
+	}
+}
+
+uint8_t SPIClass::transfer(uint8_t data)
+{
+	const uint8_t in = selected ? selected->transfer(data, clock) : 0xFF;
+	// 8 clocks, in picoseconds
+	fraction_ps += 8000000000000ull / clock;
+	simulated_ns += fraction_ps / 1000;
+	fraction_ps %= 1000;
+	return in;
+}
+
+void SPIClass::transfer(const void *txbuf, void *rxbuf, size_t count)
+{
+	const uint8_t *tx = (const uint8_t *)txbuf;
+	uint8_t *rx = (uint8_t *)rxbuf;
+	for (size_t i=0; i < count; i++) {
+		const uint8_t in = transfer(tx ? tx[i] : 0);
+		if (rx) rx[i] = in;
+	}
+}
+
+int analogRead(uint8_t pin)
+{
+	return random(1024);
+}
+
+// The same sequence on every run
+static uint32_t random_state = 1;
+
+long random(long max)
+{
+	random_state = random_state * 1103515245 + 12345;
+	return max > 0 ? (long)((random_state >> 8) % max) : 0;
+}
+
+long random(long min, long max)
+{
+	return min < max ? min + random(max - min) : min;
+}
+
+void randomSeed(uint32_t seed)
+{
+	random_state = seed;
+}
+
+size_t strlcpy(char *dst, const char *src, size_t size)
+{
+	const size_t len = strlen(src);
+	if (size) {
+		const size_t n = (len < size - 1) ? len : size - 1;
+		memcpy(dst, src, n);
+		dst[n] = 0;
+	}
+	return len;
+}
+
+int Print::printf(const char *format, ...)
+{
+	char buf[1024];
+	va_list args;
+	va_start(args, format);
+	int len = vsnprintf(buf, sizeof(buf), format, args);
+	va_end(args);
+	if (len > (int)sizeof(buf) - 1) len = sizeof(buf) - 1;
+	if (len > 0) write((const uint8_t *)buf, len);
+	return len;
+}
+
+unsigned long teensy3_clock_class::get()
+{
+	return time(nullptr);
+}
+
+void breakTime(uint32_t time, DateTimeFields &tm)
+{
+	const time_t t = time;
+	struct tm g;
+	gmtime_r(&t, &g);
+	tm.sec = g.tm_sec;
+	tm.min = g.tm_min;
+	tm.hour = g.tm_hour;
+	tm.wday = g.tm_wday;
+	tm.mday = g.tm_mday;
+	tm.mon = g.tm_mon;
+	tm.year = g.tm_year;
+}
+
+uint32_t makeTime(const DateTimeFields &tm)
+{
+	struct tm g = {};
+	g.tm_sec = tm.sec;
+	g.tm_min = tm.min;
+	g.tm_hour = tm.hour;
+	g.tm_mday = tm.mday;
+	g.tm_mon = tm.mon;
+	g.tm_year = tm.year;
+	return timegm(&g);
+}
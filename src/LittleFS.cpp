@@ -23,7 +23,8 @@
 #include <Arduino.h>
 #include <LittleFS.h>
 
-#define SPICONFIG   SPISettings(30000000, MSBFIRST, SPI_MODE0)
+#define SPICLOCK    30000000	// SCK unless begin() or calibrateClock() chooses another
+#define SPICONFIG(clock)   SPISettings(clock, MSBFIRST, SPI_MODE0)
 
 
 
@@ -36,41 +37,48 @@ PROGMEM static const struct chipinfo {
 	uint32_t chipsize;	// total number of bytes in the chip
 	uint32_t progtime;	// maximum microseconds to wait for page programming
 	uint32_t erasetime;	// maximum microseconds to wait for sector erase
-	const char pn[22];		//flash name
+	char pn[22];		//flash name
+	uint8_t readcmd;	// 0x0B for fast read with 8 dummy clocks, 0 for read 0x03
+	uint8_t maxmhz;		// maximum SCK in MHz, with readcmd for reads, 0 for 30 MHz
+	uint8_t quadread;	// QSPI 1-1-4 read command, 0 for the default
+	uint8_t quaddummy;	// QSPI dummy cycles for quadread, after the mode cycles
+	uint8_t quadmode;	// QSPI mode cycles for quadread
+	uint8_t nosector;	// 1 if the chip can't erase 4K sectors
+	uint32_t sectortime;	// maximum microseconds for 4K sector erase, 0 for 400 ms
 } known_chips[] = {
-{{0xEF, 0x40, 0x15}, 24, 256, 32768, 0x52, 2097152, 3000, 1600000, "W25Q16JV-Q"},  // Winbond W25Q16JV*Q/W25Q16FV
-{{0xEF, 0x40, 0x16}, 24, 256, 32768, 0x52, 4194304, 3000, 1600000, "W25Q32JV-Q"},  // Winbond W25Q32JV*Q/W25Q32FV
-{{0xEF, 0x40, 0x17}, 24, 256, 65536, 0xD8, 8388608, 3000, 2000000, "W25Q64JV-Q"},  // Winbond W25Q64JV*Q/W25Q64FV
-{{0xEF, 0x40, 0x18}, 24, 256, 65536, 0xD8, 16777216, 3000, 2000000, "W25Q128JV-Q"}, // Winbond W25Q128JV*Q/W25Q128FV
-{{0xEF, 0x40, 0x19}, 32, 256, 65536, 0xDC, 33554432, 3000, 2000000, "W25Q256JV-Q"}, // Winbond W25Q256JV*Q
-{{0xEF, 0x40, 0x20}, 32, 256, 65536, 0xDC, 67108864, 3500, 2000000, "W25Q512JV-Q"}, // Winbond W25Q512JV*Q
-{{0xEF, 0x40, 0x21}, 32, 256, 65536, 0xDC, 134217728, 3500, 2000000, "W25Q01JV-Q"},// Winbond W25Q01JV*Q
-{{0x62, 0x06, 0x13}, 24, 256,  4096, 0x20, 524288, 5000, 300000, "SST25PF040C"},  // Microchip SST25PF040C
+{{0xEF, 0x40, 0x15}, 24, 256, 32768, 0x52, 2097152, 3000, 1600000, "W25Q16JV-Q", 0x0B, 133},  // Winbond W25Q16JV*Q/W25Q16FV
+{{0xEF, 0x40, 0x16}, 24, 256, 32768, 0x52, 4194304, 3000, 1600000, "W25Q32JV-Q", 0x0B, 133},  // Winbond W25Q32JV*Q/W25Q32FV
+{{0xEF, 0x40, 0x17}, 24, 256, 65536, 0xD8, 8388608, 3000, 2000000, "W25Q64JV-Q", 0x0B, 133},  // Winbond W25Q64JV*Q/W25Q64FV
+{{0xEF, 0x40, 0x18}, 24, 256, 65536, 0xD8, 16777216, 3000, 2000000, "W25Q128JV-Q", 0x0B, 133}, // Winbond W25Q128JV*Q/W25Q128FV
+{{0xEF, 0x40, 0x19}, 32, 256, 65536, 0xDC, 33554432, 3000, 2000000, "W25Q256JV-Q", 0x0B, 133}, // Winbond W25Q256JV*Q
+{{0xEF, 0x40, 0x20}, 32, 256, 65536, 0xDC, 67108864, 3500, 2000000, "W25Q512JV-Q", 0x0B, 133}, // Winbond W25Q512JV*Q
+{{0xEF, 0x40, 0x21}, 32, 256, 65536, 0xDC, 134217728, 3500, 2000000, "W25Q01JV-Q", 0x0B, 133},// Winbond W25Q01JV*Q
+{{0x62, 0x06, 0x13}, 24, 256,  4096, 0x20, 524288, 5000, 300000, "SST25PF040C", 0x0B, 40},  // Microchip SST25PF040C
 //{{0xEF, 0x40, 0x14}, 24, 256,  4096, 0x20, 1048576, 5000, 300000, "W25Q80DV"},  // Winbond W25Q80DV  not tested
-{{0xEF, 0x70, 0x17}, 24, 256, 65536, 0xD8, 8388608, 3000, 2000000, "W25Q64JV-M"},  // Winbond W25Q64JV*M (DTR)
-{{0xEF, 0x70, 0x18}, 24, 256, 65536, 0xD8, 16777216, 3000, 2000000, "W25Q128JV-M"}, // Winbond W25Q128JV*M (DTR)
-{{0xEF, 0x70, 0x19}, 32, 256, 65536, 0xDC, 33554432, 3000, 2000000, "W25Q256JV-M"}, // Winbond W25Q256JV*M (DTR)
-{{0xEF, 0x80, 0x19}, 32, 256, 65536, 0xDC, 33554432, 3000, 2000000, "W25Q256JW-M"}, // Winbond (W25Q256JW*M)
-{{0xEF, 0x70, 0x20}, 32, 256, 65536, 0xDC, 67108864, 3500, 2000000, "W25Q512JV-M"}, // Winbond W25Q512JV*M (DTR)
-{{0x1F, 0x84, 0x01}, 24, 256,  4096, 0x20, 524288, 2500, 300000, "AT25SF041"},    // Adesto/Atmel AT25SF041
-{{0x01, 0x40, 0x14}, 24, 256,  4096, 0x20, 1048576, 5000, 300000, "S25FL208K"},   // Spansion S25FL208K
-{{0xC8, 0x40, 0x13}, 24, 256,  4096, 0x20,  524288, 2400, 300000, "GD25Q40C"},   // GigaDevice GD25Q40C
-{{0xC8, 0x40, 0x14}, 24, 256,  4096, 0x20, 1048576, 2400, 300000, "GD25Q80C"},   // GigaDevice GD25Q80C
-{{0xC8, 0x40, 0x15}, 24, 256, 32768, 0x52, 2097152, 4000, 1600000, "GD25Q16E"},  // GigaDevice GD25Q16E
-{{0xC8, 0x40, 0x16}, 24, 256, 32768, 0x52, 4194304, 4000, 1600000, "GD25Q32E"},  // GigaDevice GD25Q32E
-{{0xC8, 0x40, 0x17}, 24, 256, 65536, 0xD8, 8388608, 4000, 3000000, "GD25Q64E"},  // GigaDevice GD25Q64E
-{{0xC8, 0x40, 0x18}, 24, 256, 65536, 0xD8, 16777216, 4000, 3000000, "GD25Q128E"},  // GigaDevice GD25Q128E
-{{0xC8, 0x40, 0x19}, 32, 256, 65536, 0xDC, 33554432, 2000, 1600000, "GD25Q256E"},  // GigaDevice GD25Q256E
+{{0xEF, 0x70, 0x17}, 24, 256, 65536, 0xD8, 8388608, 3000, 2000000, "W25Q64JV-M", 0x0B, 133},  // Winbond W25Q64JV*M (DTR)
+{{0xEF, 0x70, 0x18}, 24, 256, 65536, 0xD8, 16777216, 3000, 2000000, "W25Q128JV-M", 0x0B, 133}, // Winbond W25Q128JV*M (DTR)
+{{0xEF, 0x70, 0x19}, 32, 256, 65536, 0xDC, 33554432, 3000, 2000000, "W25Q256JV-M", 0x0B, 133}, // Winbond W25Q256JV*M (DTR)
+{{0xEF, 0x80, 0x19}, 32, 256, 65536, 0xDC, 33554432, 3000, 2000000, "W25Q256JW-M", 0x0B, 133}, // Winbond (W25Q256JW*M)
+{{0xEF, 0x70, 0x20}, 32, 256, 65536, 0xDC, 67108864, 3500, 2000000, "W25Q512JV-M", 0x0B, 133}, // Winbond W25Q512JV*M (DTR)
+{{0x1F, 0x84, 0x01}, 24, 256,  4096, 0x20, 524288, 2500, 300000, "AT25SF041", 0x0B, 104},    // Adesto/Atmel AT25SF041
+{{0x01, 0x40, 0x14}, 24, 256,  4096, 0x20, 1048576, 5000, 300000, "S25FL208K", 0x0B, 76},   // Spansion S25FL208K
+{{0xC8, 0x40, 0x13}, 24, 256,  4096, 0x20,  524288, 2400, 300000, "GD25Q40C", 0x0B, 120},   // GigaDevice GD25Q40C
+{{0xC8, 0x40, 0x14}, 24, 256,  4096, 0x20, 1048576, 2400, 300000, "GD25Q80C", 0x0B, 120},   // GigaDevice GD25Q80C
+{{0xC8, 0x40, 0x15}, 24, 256, 32768, 0x52, 2097152, 4000, 1600000, "GD25Q16E", 0x0B, 133},  // GigaDevice GD25Q16E
+{{0xC8, 0x40, 0x16}, 24, 256, 32768, 0x52, 4194304, 4000, 1600000, "GD25Q32E", 0x0B, 133},  // GigaDevice GD25Q32E
+{{0xC8, 0x40, 0x17}, 24, 256, 65536, 0xD8, 8388608, 4000, 3000000, "GD25Q64E", 0x0B, 133},  // GigaDevice GD25Q64E
+{{0xC8, 0x40, 0x18}, 24, 256, 65536, 0xD8, 16777216, 4000, 3000000, "GD25Q128E", 0x0B, 133},  // GigaDevice GD25Q128E
+{{0xC8, 0x40, 0x19}, 32, 256, 65536, 0xDC, 33554432, 2000, 1600000, "GD25Q256E", 0x0B, 133},  // GigaDevice GD25Q256E
 //FRAM
-{{0x03, 0x2E, 0xC2}, 24, 64, 128, 0, 1048576, 250, 1200, "CY15B108QN"}, //Cypress 8Mb FRAM, CY15B108QN
-{{0xC2, 0x24, 0x00}, 24, 64, 128, 0, 131072, 250, 1200, "FM25V10-G"},  //Cypress 1Mb FRAM, FM25V10-G
-{{0xC2, 0x24, 0x01}, 24, 64, 128, 0, 131072, 250, 1200, "FM25V10-G (rev 1)"},  //Cypress 1Mb FRAM, rev1
-{{0xAE, 0x83, 0x09}, 24, 64, 128, 0, 131072, 250, 1200, "MR45V100A"},  //ROHM MR45V100A 1 Mbit FeRAM Memory
-{{0xC2, 0x26, 0x08}, 24, 64, 128, 0, 524288, 250, 1200, "CY15B104Q"},  //Cypress 4Mb FRAM, CY15B104Q
-{{0x60, 0x2A, 0xC2}, 24, 64, 128, 0, 262144, 250, 1200, "CY15B102Q"},  //Cypress 2Mb FRAM, CY15B102Q
-{{0x60, 0x2A, 0xC2}, 24, 64, 128, 0, 262144, 250, 1200, "CY15B102Q"},  //Cypress 2Mb FRAM, CY15B102Q
-{{0x04, 0x7F, 0x48}, 24, 64, 128, 0, 262144, 250, 1200, "MB85RS2MTAPNF"},  //Fujitsu 2Mb FRAM, MB85RS2MTAPNF
-{{0x04, 0x7F, 0x49}, 24, 64, 128, 0, 524288, 250, 1200, "MB85RS4MT"},  //Fujitsu 4Mb FRAM, MB85RS2MT
+{{0x03, 0x2E, 0xC2}, 24, 64, 128, 0, 1048576, 250, 1200, "CY15B108QN", 0, 50}, //Cypress 8Mb FRAM, CY15B108QN
+{{0xC2, 0x24, 0x00}, 24, 64, 128, 0, 131072, 250, 1200, "FM25V10-G", 0, 40},  //Cypress 1Mb FRAM, FM25V10-G
+{{0xC2, 0x24, 0x01}, 24, 64, 128, 0, 131072, 250, 1200, "FM25V10-G (rev 1)", 0, 40},  //Cypress 1Mb FRAM, rev1
+{{0xAE, 0x83, 0x09}, 24, 64, 128, 0, 131072, 250, 1200, "MR45V100A", 0, 40},  //ROHM MR45V100A 1 Mbit FeRAM Memory
+{{0xC2, 0x26, 0x08}, 24, 64, 128, 0, 524288, 250, 1200, "CY15B104Q", 0, 40},  //Cypress 4Mb FRAM, CY15B104Q
+{{0x60, 0x2A, 0xC2}, 24, 64, 128, 0, 262144, 250, 1200, "CY15B102Q", 0, 40},  //Cypress 2Mb FRAM, CY15B102Q
+{{0x60, 0x2A, 0xC2}, 24, 64, 128, 0, 262144, 250, 1200, "CY15B102Q", 0, 40},  //Cypress 2Mb FRAM, CY15B102Q
+{{0x04, 0x7F, 0x48}, 24, 64, 128, 0, 262144, 250, 1200, "MB85RS2MTAPNF", 0, 40},  //Fujitsu 2Mb FRAM, MB85RS2MTAPNF
+{{0x04, 0x7F, 0x49}, 24, 64, 128, 0, 524288, 250, 1200, "MB85RS4MT", 0, 40},  //Fujitsu 4Mb FRAM, MB85RS2MT
 
 };
 
@@ -86,6 +94,177 @@ static const struct chipinfo * chip_lookup(const uint8_t *id)
 	return nullptr;
 }
 
+// Describe a chip not in known_chips from its JEDEC SFDP basic flash
+// parameter table.  read() reads SFDP space, as command 0x5A does.
+static bool sfdp_chipinfo(struct chipinfo *info, const uint8_t *id,
+  void (*read)(void *ctx, uint32_t addr, void *buf, uint32_t len), void *ctx)
+{
+	uint32_t header[4];
+	read(ctx, 0, header, sizeof(header));
+	if (header[0] != 0x50444653) return false; // "SFDP"
+	// the first parameter header is always the basic flash parameter table
+	const uint8_t *param = (const uint8_t *)(header + 2);
+	if (param[0] != 0x00) return false;
+	uint32_t len = param[3];
+	if (len < 9) return false;
+	if (len > 16) len = 16;
+	uint32_t bfpt[16] = {0};
+	read(ctx, param[4] | (param[5] << 8) | (param[6] << 16), bfpt, len * 4);
+
+	// density, in bits
+	uint64_t bits;
+	if (bfpt[1] & 0x80000000) {
+		const uint32_t n = bfpt[1] & 0x7FFFFFFF;
+		if (n < 19 || n > 34) return false; // 64 Kbyte to 2 Gbyte
+		bits = (uint64_t)1 << n;
+	} else {
+		bits = (uint64_t)bfpt[1] + 1;
+	}
+	const uint32_t chipsize = bits / 8;
+	if (chipsize < 65536) return false;
+
+	// erase types, with typical times from JESD216A on
+	uint32_t erasesize[4], erasetime[4];
+	uint8_t erasecmd[4];
+	for (int i=0; i < 4; i++) {
+		const uint32_t type = bfpt[7 + i / 2] >> ((i & 1) * 16);
+		erasesize[i] = (type & 0xFF) ? (uint32_t)1 << (type & 0x1F) : 0;
+		erasecmd[i] = type >> 8;
+		erasetime[i] = 2000000;
+		if (len >= 10) {
+			static const uint32_t units[4] = {1000, 16000, 128000, 1000000};
+			const uint32_t t = bfpt[9] >> (4 + i * 7);
+			const uint32_t typical = ((t & 0x1F) + 1) * units[(t >> 5) & 3];
+			erasetime[i] = 2 * ((bfpt[9] & 0x0F) + 1) * typical;
+		}
+	}
+	// like known_chips, smaller chips get smaller blocks, up to 64K: the
+	// largest erase up to chipsize / 64, or if there's none, the smallest
+	uint32_t target = chipsize / 64;
+	if (target > 65536) target = 65536;
+	int erase = -1;
+	for (int i=0; i < 4; i++) {
+		if (erasesize[i] < 256 || erasesize[i] > target) continue;
+		if (erase < 0 || erasesize[i] > erasesize[erase]) erase = i;
+	}
+	if (erase < 0) {
+		for (int i=0; i < 4; i++) {
+			if (erasesize[i] < 256 || erasesize[i] > 65536) continue;
+			if (erase < 0 || erasesize[i] < erasesize[erase]) erase = i;
+		}
+	}
+	if (erase < 0) return false;
+
+	memset(info, 0, sizeof(*info));
+	memcpy(info->id, id, 3);
+	info->chipsize = chipsize;
+	info->erasesize = erasesize[erase];
+	info->erasecmd = erasecmd[erase];
+	info->erasetime = erasetime[erase];
+	info->nosector = 1;
+	for (int i=0; i < 4; i++) {
+		if (erasesize[i] == 4096 && erasecmd[i] == 0x20) {
+			info->nosector = 0;
+			info->sectortime = erasetime[i];
+		}
+	}
+	info->progsize = 256;
+	info->progtime = 5000;
+	if (len >= 11) {
+		const uint32_t page = (bfpt[10] >> 4) & 0x0F;
+		if (page >= 4 && page <= 9) info->progsize = 1 << page;
+		const uint32_t t = bfpt[10] >> 8;
+		const uint32_t typical = ((t & 0x1F) + 1) * ((t & 0x20) ? 64 : 8);
+		info->progtime = 2 * ((bfpt[10] & 0x0F) + 1) * typical;
+	}
+	// every SFDP chip has fast read, and runs it at 50 MHz or faster
+	info->readcmd = 0x0B;
+	info->maxmhz = 50;
+	info->addrbits = 24;
+	if (chipsize > 16777216) {
+		// the 4 byte address form of each erase command
+		info->addrbits = 32;
+		if (info->erasecmd == 0x20) info->erasecmd = 0x21;
+		else if (info->erasecmd == 0x52) info->erasecmd = 0x5C;
+		else if (info->erasecmd == 0xD8) info->erasecmd = 0xDC;
+		else return false;
+	} else if (bfpt[0] & (1 << 22)) {
+		// fast read 1-1-4
+		info->quadread = bfpt[2] >> 24;
+		info->quaddummy = (bfpt[2] >> 16) & 0x1F;
+		info->quadmode = (bfpt[2] >> 21) & 0x07;
+	}
+	snprintf(info->pn, sizeof(info->pn), "SFDP %02X%02X%02X", id[0], id[1], id[2]);
+	return true;
+}
+
+// Cache size for a chip, the largest power of two multiple of its page size
+// up to the requested size and the erase size.  Zero requests one page.
+static uint32_t cache_size_for(const struct chipinfo *info, uint32_t blocksize, uint32_t request)
+{
+	uint32_t size = info->progsize;
+	while (size * 2 <= request && size * 2 <= blocksize) size *= 2;
+	return size;
+}
+
+// Erase command and maximum time for a block size, either the chip's erase
+// size or 4K sectors, which NOR chips erase with 0x20 (0x21 with 32 bit
+// addresses).  Returns false if the chip can't erase blocks of that size.
+static bool erase_for(const struct chipinfo *info, uint32_t blocksize, uint8_t *cmd, uint32_t *time)
+{
+	if (blocksize == info->erasesize) {
+		*cmd = info->erasecmd;
+		*time = info->erasetime;
+		return true;
+	}
+	if (blocksize != 4096 || !info->erasecmd || info->nosector) return false;
+	*cmd = (info->addrbits == 32) ? 0x21 : 0x20;
+	*time = info->sectortime ? info->sectortime : 400000;
+	return true;
+}
+
+// Maximum SCK for a chip, SPICLOCK when it isn't listed
+static uint32_t chip_clock(const struct chipinfo *info)
+{
+	return info->maxmhz ? info->maxmhz * 1000000 : SPICLOCK;
+}
+
+// Read command and SCK for a chip: fast read (0x0C with 32 bit addresses)
+// or plain read, at SPICLOCK unless spiclock asks for another clock, and
+// never above the chip's maximum.  Boards wired for 30 MHz keep working
+// until begin() or calibrateClock() chooses a faster clock.
+static uint8_t read_command(const struct chipinfo *info, uint32_t spiclock, uint32_t *clock)
+{
+	const uint32_t maxclock = chip_clock(info);
+	*clock = spiclock ? spiclock : SPICLOCK;
+	if (*clock > maxclock) *clock = maxclock;
+	if (info->readcmd != 0x0B) return (info->addrbits == 32) ? 0x13 : 0x03;
+	return (info->addrbits == 32) ? 0x0C : 0x0B;
+}
+
+#define POLL_MIN_US          8     // first status poll interval after the typical time
+#define SUSPEND_MIN_US       200   // least time an erase runs between suspends
+#define SUSPEND_TIMEOUT_US   1000  // chips suspend within 20 to 50 us
+
+// Update the typical time of a program or erase with one which took us.  A
+// chip found ready at the first poll may have been ready long before, so it
+// only counts when faster than expected.
+static uint32_t learn_typical(uint32_t typical_us, uint32_t us, bool waited)
+{
+	// yield() may have run other code for a long time
+	if (us > typical_us * 4 && typical_us) us = typical_us * 4;
+	if (!typical_us) return waited ? us : 0;
+	if (!waited && us >= typical_us) return typical_us;
+	return (typical_us * 3 + us) / 4;
+}
+
+// Winbond and GigaDevice NOR suspend erases with 0x75 and resume with 0x7A,
+// and report suspended in bit 7 of status register 2
+static bool chip_can_suspend(const struct chipinfo *info)
+{
+	return info->erasecmd && (info->id[0] == 0xEF || info->id[0] == 0xC8);
+}
+
 
 const char * LittleFS_RAM::getMediaName() {
 	PROGMEM static const char ram_pn_name[] = "MEMORY";
@@ -100,10 +279,12 @@ const char * LittleFS_RAM::getMediaName() {
 }
 
 FLASHMEM
-bool LittleFS_SPIFlash::begin(uint8_t cspin, SPIClass &spiport)
+bool LittleFS_SPIFlash::begin(uint8_t cspin, SPIClass &spiport, uint32_t cacheSize, uint32_t blockSize, uint32_t spiClock)
 {
+	finish(); // a chip still busy won't answer the ID command
 	pin = cspin;
 	port = &spiport;
+	spiclock = (spiClock && spiClock < SPICLOCK) ? spiClock : SPICLOCK;
 
 	//Serial.println("flash begin");
 	configured = false;
@@ -112,7 +293,7 @@ bool LittleFS_SPIFlash::begin(uint8_t cspin, SPIClass &spiport)
 	port->begin();
 
 	uint8_t buf[4] = {0x9F, 0, 0, 0};
-	port->beginTransaction(SPICONFIG);
+	port->beginTransaction(SPICONFIG(spiclock));
 	digitalWrite(pin, LOW);
 	port->transfer(buf, 4);
 	digitalWrite(pin, HIGH);
@@ -120,8 +301,22 @@ bool LittleFS_SPIFlash::begin(uint8_t cspin, SPIClass &spiport)
 
 	//Serial.printf("Flash ID: %02X %02X %02X  %02X\n", buf[1], buf[2], buf[3], buf[4]);
 	const struct chipinfo *info = chip_lookup(buf + 1);
-	if (!info) return false;
+	if (!info) {
+		// not a known chip, try describing it from its SFDP table
+		if (!sfdp_info) sfdp_info = malloc(sizeof(struct chipinfo));
+		if (!sfdp_info) return false;
+		if (!sfdp_chipinfo((struct chipinfo *)sfdp_info, buf + 1, &static_sfdp, this)) return false;
+		info = (const struct chipinfo *)sfdp_info;
+	}
+	const uint32_t block_size = blockSize ? blockSize : info->erasesize;
+	if (!erase_for(info, block_size, &erasecmd, &erasetime)) return false;
 	hwinfo = info;
+	readcmd = read_command(info, spiClock, &readclock);
+	if (spiClock) spiclock = readclock;
+	else if (spiclock > chip_clock(info)) spiclock = chip_clock(info);
+	can_suspend = chip_can_suspend(info);
+	prog_us = 0;
+	erase_us = 0;
 	//Serial.printf("Flash size is %.2f Mbyte\n", (float)info->chipsize / 1048576.0f);
 
 	memset(&lfs, 0, sizeof(lfs));
@@ -131,12 +326,14 @@ bool LittleFS_SPIFlash::begin(uint8_t cspin, SPIClass &spiport)
 	config.prog = &static_prog;
 	config.erase = &static_erase;
 	config.sync = &static_sync;
+	erase_time_us = erasetime;
+	attachStats();
 	config.read_size = info->progsize;
 	config.prog_size = info->progsize;
-	config.block_size = info->erasesize;
-	config.block_count = info->chipsize / info->erasesize;
+	config.block_size = block_size;
+	config.block_count = info->chipsize / block_size;
 	config.block_cycles = 400;
-	config.cache_size = info->progsize;
+	config.cache_size = cache_size_for(info, block_size, cacheSize);
 	config.lookahead_size = info->progsize;
 	// config.lookahead_size = config.block_count/8;
 	config.name_max = LFS_NAME_MAX;
@@ -169,10 +366,36 @@ const char * LittleFS_SPIFlash::getMediaName() {
 }
 
 FLASHMEM
-bool LittleFS_SPIFram::begin(uint8_t cspin, SPIClass &spiport)
+uint32_t LittleFS_SPIFlash::calibrateClock(uint32_t maxClock)
+{
+	if (!hwinfo) return 0;
+	const uint32_t chipclock = chip_clock((const struct chipinfo *)hwinfo);
+	if (!maxClock || maxClock > chipclock) maxClock = chipclock;
+	const uint32_t old_readclock = readclock;
+	const uint32_t clock = findClock(maxClock, &static_clock);
+	if (!clock) readclock = old_readclock;
+	return clock;
+}
+
+FLASHMEM
+void LittleFS_SPIFlash::readSFDP(uint32_t addr, void *buf, uint32_t len)
+{
+	uint8_t cmdaddr[5] = {0x5A, (uint8_t)(addr >> 16), (uint8_t)(addr >> 8), (uint8_t)addr, 0};
+	memset(buf, 0xFF, len);
+	port->beginTransaction(SPICONFIG(spiclock));
+	digitalWrite(pin, LOW);
+	port->transfer(cmdaddr, 5); // 0x5A = read SFDP, 24 bit address, 8 dummy clocks
+	port->transfer(buf, len);
+	digitalWrite(pin, HIGH);
+	port->endTransaction();
+}
+
+FLASHMEM
+bool LittleFS_SPIFram::begin(uint8_t cspin, SPIClass &spiport, uint32_t spiClock)
 {
 	pin = cspin;
 	port = &spiport;
+	spiclock = (spiClock && spiClock < SPICLOCK) ? spiClock : SPICLOCK;
 
 	//Serial.printf("flash begin cs:%u\n", pin);
 	configured = false;
@@ -183,7 +406,7 @@ bool LittleFS_SPIFram::begin(uint8_t cspin, SPIClass &spiport)
 	delay(100);
 	uint8_t buf[9];
 	
-	port->beginTransaction(SPICONFIG);
+	port->beginTransaction(SPICONFIG(spiclock));
 	digitalWrite(pin, LOW);
 	delayNanoseconds(50);
 	port->transfer(0x9f);  //0x9f - JEDEC register
@@ -203,6 +426,9 @@ bool LittleFS_SPIFram::begin(uint8_t cspin, SPIClass &spiport)
 	const struct chipinfo *info = chip_lookup(buf );
 	if (!info) return false;
 	hwinfo = info;
+	if (spiClock) spiclock = (spiClock < chip_clock(info)) ? spiClock : chip_clock(info);
+	else if (spiclock > chip_clock(info)) spiclock = chip_clock(info);
+	readclock = spiclock;
 	//Serial.printf("Flash size is %.2f Mbyte\n", (float)info->chipsize / 1048576.0f);
 
 	memset(&lfs, 0, sizeof(lfs));
@@ -212,6 +438,8 @@ bool LittleFS_SPIFram::begin(uint8_t cspin, SPIClass &spiport)
 	config.prog = &static_prog;
 	config.erase = &static_erase;
 	config.sync = &static_sync;
+	erase_time_us = info->erasetime;
+	attachStats();
 	config.read_size = info->progsize;
 	config.prog_size = info->progsize;
 	config.block_size = info->erasesize;
@@ -242,6 +470,18 @@ bool LittleFS_SPIFram::begin(uint8_t cspin, SPIClass &spiport)
 	return true;
 }
 
+FLASHMEM
+uint32_t LittleFS_SPIFram::calibrateClock(uint32_t maxClock)
+{
+	if (!hwinfo) return 0;
+	const uint32_t chipclock = chip_clock((const struct chipinfo *)hwinfo);
+	if (!maxClock || maxClock > chipclock) maxClock = chipclock;
+	const uint32_t old_readclock = readclock;
+	const uint32_t clock = findClock(maxClock, &static_clock);
+	if (!clock) readclock = old_readclock;
+	return clock;
+}
+
 FLASHMEM
 const char * LittleFS_SPIFram::getMediaName() {
 	if (!hwinfo) return nullptr;
@@ -275,6 +515,265 @@ bool LittleFS::quickFormat()
 	return true;
 }
 
+// Fixed pools for LittleFSFile objects, their file or dir handles and
+// their file caches, one slot of each per file which can be open at once
+// without using the heap.
+#define POOL_SLOT(size) (((size) + 7) & ~7)
+#define POOL_HANDLE_SIZE (sizeof(LittleFS_FileHandle) > sizeof(lfs_dir_t) \
+	? sizeof(LittleFS_FileHandle) : sizeof(lfs_dir_t))
+#if LITTLEFS_POOL_FILES > 0
+static const size_t pool_slot[3] = {
+	POOL_SLOT(sizeof(LittleFSFile)),
+	POOL_SLOT(POOL_HANDLE_SIZE),
+	POOL_SLOT(LITTLEFS_POOL_CACHE_SIZE)
+};
+static_assert(LITTLEFS_POOL_FILES <= 32, "LITTLEFS_POOL_FILES is limited to 32");
+alignas(8) static uint8_t pool_objects[LITTLEFS_POOL_FILES * POOL_SLOT(sizeof(LittleFSFile))];
+alignas(8) static uint8_t pool_handles[LITTLEFS_POOL_FILES * POOL_SLOT(POOL_HANDLE_SIZE)];
+alignas(8) static uint8_t pool_caches[LITTLEFS_POOL_FILES * POOL_SLOT(LITTLEFS_POOL_CACHE_SIZE)];
+static uint8_t * const pool_base[3] = {pool_objects, pool_handles, pool_caches};
+static uint32_t pool_used[3];   // one bit per slot
+#endif
+
+LittleFS_PoolStats LittleFSFile::pool_stats;
+
+LittleFS_PoolCounter & LittleFSFile::poolCounter(int pool)
+{
+	LittleFS_PoolStats &s = pool_stats;
+	if (pool == LITTLEFS_POOL_OBJECT) return s.objects;
+	if (pool == LITTLEFS_POOL_HANDLE) return s.handles;
+	return s.caches;
+}
+
+void * LittleFSFile::poolAlloc(int pool, size_t size)
+{
+	void *ptr = nullptr;
+#if LITTLEFS_POOL_FILES > 0
+	if (size <= pool_slot[pool] && pool_used[pool] != (uint32_t)((1ull << LITTLEFS_POOL_FILES) - 1)) {
+		unsigned int i = __builtin_ctz(~pool_used[pool]);
+		pool_used[pool] |= 1ul << i;
+		ptr = pool_base[pool] + i * pool_slot[pool];
+	}
+#endif
+	LittleFS_PoolCounter &c = poolCounter(pool);
+	if (!ptr) {
+		ptr = malloc(size);
+		if (!ptr) return nullptr;
+		c.heap++;
+	}
+	if (++c.in_use > c.high_water) c.high_water = c.in_use;
+	return ptr;
+}
+
+void LittleFSFile::poolFree(int pool, void *ptr)
+{
+	if (!ptr) return;
+	poolCounter(pool).in_use--;
+#if LITTLEFS_POOL_FILES > 0
+	uint8_t *p = (uint8_t *)ptr;
+	if (p >= pool_base[pool] && p < pool_base[pool] + LITTLEFS_POOL_FILES * pool_slot[pool]) {
+		pool_used[pool] &= ~(1ul << ((p - pool_base[pool]) / pool_slot[pool]));
+		return;
+	}
+#endif
+	free(ptr);
+}
+
+// Mount again, after changing config of an already mounted filesystem
+FLASHMEM
+bool LittleFS::remount()
+{
+	if (mounted) {
+		lfs_unmount(&lfs);
+		mounted = false;
+	}
+	if (lfs_mount(&lfs, &config) < 0) return false;
+	mounted = true;
+	return true;
+}
+
+FLASHMEM
+bool LittleFS::readCache(uint32_t lines, void *buffer)
+{
+	if (!mounted) return false;
+	if (lfs.mlist) return false; // remounting would lose open files
+	config.read_cache_lines = lines;
+	config.read_cache_lines_buffer = buffer;
+	if (!remount()) {
+		// not enough memory for the lines, go back to no extra cache
+		config.read_cache_lines = 0;
+		config.read_cache_lines_buffer = nullptr;
+		remount();
+		return false;
+	}
+	return true;
+}
+
+FLASHMEM
+bool LittleFS::setDirCache(uint32_t entries)
+{
+	if (!mounted) return false;
+	if (lfs.mlist) return false; // remounting would lose open files
+	config.mdir_cache_count = entries;
+	if (!remount()) {
+		config.mdir_cache_count = 0;
+		remount();
+		return false;
+	}
+	return true;
+}
+
+FLASHMEM
+bool LittleFS::setPathCache(uint32_t entries)
+{
+	if (!mounted) return false;
+	if (lfs.mlist) return false; // remounting would lose open files
+	config.dentry_cache_count = entries;
+	if (!remount()) {
+		config.dentry_cache_count = 0;
+		remount();
+		return false;
+	}
+	return true;
+}
+
+FLASHMEM
+bool LittleFS::allocBitmap(void *buffer, uint32_t size)
+{
+	if (!mounted) return false;
+	if (lfs.mlist) return false; // remounting would lose open files
+	// one bit per block, littlefs needs a multiple of 8 bytes
+	const uint32_t needed = ((config.block_count + 63) / 64) * 8;
+	if (buffer && (size < needed || ((uintptr_t)buffer & 3))) return false;
+	if (!buffer && config.lookahead_size >= needed) return true;
+	const lfs_size_t old_size = config.lookahead_size;
+	void * const old_buffer = config.lookahead_buffer;
+	config.lookahead_size = needed;
+	config.lookahead_buffer = buffer;
+	if (!remount()) {
+		config.lookahead_size = old_size;
+		config.lookahead_buffer = old_buffer;
+		remount();
+		return false;
+	}
+	return true;
+}
+
+#if LITTLEFS_STATS
+// Route the media's functions through the counting wrappers.  Each begin()
+// calls this after filling in config, before littlefs uses it.
+void LittleFS::attachStats()
+{
+	used_valid = false;
+	free(idle_used); // begin() may have changed the block count
+	idle_used = nullptr;
+	erased_blocks = 0; // the media may have been written since the last begin()
+	config.fs = this;
+	config.media_read = config.read;
+	config.media_prog = config.prog;
+	config.media_erase = config.erase;
+	config.media_sync = config.sync;
+	config.read = &stats_read;
+	config.prog = &stats_prog;
+	config.erase = &stats_erase;
+	config.sync = &stats_sync;
+}
+
+void LittleFS::record_io(uint8_t op, LittleFS_IOCounter &counter, lfs_block_t block,
+  lfs_off_t offset, lfs_size_t size, uint32_t begin_us, int err)
+{
+	const uint32_t us = micros() - begin_us;
+	counter.count++;
+	counter.bytes += size;
+	counter.total_us += us;
+	if (us > counter.max_us) counter.max_us = us;
+	if (!tracing) return;
+	LittleFS_TraceRecord *r = trace_buf + trace_head;
+	r->us = begin_us;
+	r->duration_us = us;
+	r->block = block;
+	r->offset = offset;
+	r->size = size;
+	r->op = op;
+	r->err = err;
+	r->reserved = 0;
+	if (++trace_head >= trace_size) trace_head = 0;
+	if (trace_head == trace_tail) {
+		// buffer full, drop the oldest record
+		if (++trace_tail >= trace_size) trace_tail = 0;
+		trace_lost++;
+	}
+}
+
+int LittleFS::stats_read(const struct lfs_config *c, lfs_block_t block,
+  lfs_off_t offset, void *buffer, lfs_size_t size)
+{
+	const lfs_config_stats *cs = (const lfs_config_stats *)c;
+	const uint32_t begin_us = micros();
+	int r = cs->media_read(c, block, offset, buffer, size);
+	cs->fs->record_io(LITTLEFS_TRACE_READ, cs->fs->stats.read, block, offset, size, begin_us, r);
+	return r;
+}
+
+int LittleFS::stats_prog(const struct lfs_config *c, lfs_block_t block,
+  lfs_off_t offset, const void *buffer, lfs_size_t size)
+{
+	const lfs_config_stats *cs = (const lfs_config_stats *)c;
+	const uint32_t begin_us = micros();
+	cs->fs->used_valid = false;
+	if (cs->fs->idle_used) {
+		cs->fs->idle_used[block / 8] |= 1 << (block % 8);
+		cs->fs->idle_dirty = true;
+	}
+	int r = cs->media_prog(c, block, offset, buffer, size);
+	cs->fs->record_io(LITTLEFS_TRACE_PROG, cs->fs->stats.prog, block, offset, size, begin_us, r);
+	return r;
+}
+
+int LittleFS::stats_erase(const struct lfs_config *c, lfs_block_t block)
+{
+	const lfs_config_stats *cs = (const lfs_config_stats *)c;
+	const uint32_t begin_us = micros();
+	cs->fs->used_valid = false;
+	int r = cs->media_erase(c, block);
+	cs->fs->record_io(LITTLEFS_TRACE_ERASE, cs->fs->stats.erase, block, 0, c->block_size, begin_us, r);
+	return r;
+}
+
+int LittleFS::stats_sync(const struct lfs_config *c)
+{
+	const lfs_config_stats *cs = (const lfs_config_stats *)c;
+	const uint32_t begin_us = micros();
+	int r = cs->media_sync(c);
+	cs->fs->record_io(LITTLEFS_TRACE_SYNC, cs->fs->stats.sync, 0, 0, 0, begin_us, r);
+	return r;
+}
+#endif
+
+void LittleFS::beginTrace(LittleFS_TraceRecord *buffer, uint32_t count)
+{
+	tracing = false;
+	trace_buf = buffer;
+	trace_size = count;
+	trace_head = 0;
+	trace_tail = 0;
+	trace_lost = 0;
+#if LITTLEFS_STATS
+	if (buffer && count >= 2) tracing = true; // one slot always stays empty
+#endif
+}
+
+uint32_t LittleFS::readTrace(LittleFS_TraceRecord *buffer, uint32_t count)
+{
+	uint32_t n = 0;
+	if (!trace_buf) return 0;
+	while (n < count && trace_tail != trace_head) {
+		buffer[n++] = trace_buf[trace_tail];
+		if (++trace_tail >= trace_size) trace_tail = 0;
+	}
+	return n;
+}
+
 static bool blockIsBlank(struct lfs_config *config, lfs_block_t block, void *readBuf, bool full=true );
 static bool blockIsBlank(struct lfs_config *config, lfs_block_t block, void *readBuf, bool full )
 {
@@ -292,6 +791,31 @@ static bool blockIsBlank(struct lfs_config *config, lfs_block_t block, void *rea
 	return true; // all bytes read as 0xFF
 }
 
+bool LittleFS::blockErased(lfs_block_t block)
+{
+	if (block == erase_checked) {
+		// the caller just read it back and found data
+		erase_checked = (lfs_block_t)-1;
+		return false;
+	}
+	if (erased_blocks != config.block_count) {
+		free(erased_map);
+		erased_map = (uint8_t *)calloc((config.block_count + 7) / 8, 1);
+		erased_blocks = erased_map ? config.block_count : 0;
+	}
+	if (!erasedKnown(block)) {
+		void *buffer = malloc(config.read_size);
+		const bool blank = blockIsBlank(&config, block, buffer);
+		free(buffer);
+		if (!blank) return false;
+		setErased(block);
+	}
+#if LITTLEFS_STATS
+	stats.erase_skipped++;
+#endif
+	return true;
+}
+
 static int cb_usedBlocks( void *inData, lfs_block_t block )
 {
 	static lfs_block_t maxBlock;
@@ -342,7 +866,9 @@ uint32_t LittleFS::formatUnused(uint32_t blockCnt, uint32_t blockStart) {
 		uint8_t jjbit = 1<<(block%8);
 		if ( !(checkused[iiblk] & jjbit) ) { // block not in use
 			if ( !blockIsBlank(&config, block, buffer, false )) {
+				erase_checked = block;
 				(*config.erase)(&config, block);
+				erase_checked = (lfs_block_t)-1;
 				jj++;
 			}
 		}
@@ -356,6 +882,133 @@ uint32_t LittleFS::formatUnused(uint32_t blockCnt, uint32_t blockStart) {
 	return block; // return lastChecked block to store to start next pass as blockStart
 }
 
+// Like formatUnused(), but the used blocks bitmap is kept between calls.
+// Programs are seen by stats_prog(), which marks their blocks used, so
+// the filesystem is only traversed again after every unused block has
+// been checked and something was written since the last traverse.
+uint32_t LittleFS::idleErase(uint32_t budget_us)
+{
+	if (!mounted) return 0;
+	const uint32_t begin_us = micros();
+	const uint32_t n = config.block_count;
+	if (!idle_used) {
+		idle_used = (uint8_t *)malloc((n + 7) / 8 + config.read_size);
+		if (!idle_used) return 0;
+		idle_left = 0;
+		idle_dirty = true;
+	}
+	uint8_t *buffer = idle_used + (n + 7) / 8;
+	if (idle_left == 0) {
+		if (!idle_dirty) return 0; // every unused block is already erased
+		memset(idle_used, 0, (n + 7) / 8);
+		cb_usedBlocks( nullptr, n ); // init and pass MAX block_count
+		if (lfs_fs_traverse(&lfs, cb_usedBlocks, idle_used) < 0) return 0;
+		idle_dirty = false;
+		idle_left = n;
+	}
+	// skip ahead to the allocator, if it has passed the blocks we checked
+	const uint32_t alloc = (lfs.free.off + lfs.free.i) % n;
+	if ((idle_next + n - idle_alloc) % n < (alloc + n - idle_alloc) % n) {
+		idle_next = alloc;
+	}
+	idle_alloc = alloc;
+	// the longest erase seen, or the media's maximum until one is timed
+#if LITTLEFS_STATS
+	const uint32_t erase_us = stats.erase.max_us ? stats.erase.max_us : erase_time_us;
+#else
+	const uint32_t erase_us = erase_time_us;
+#endif
+	uint32_t erased = 0;
+	// don't start an erase which may not finish within the budget
+	while (idle_left > 0 && micros() - begin_us + erase_us <= budget_us) {
+		const uint32_t block = idle_next;
+		if (++idle_next >= n) idle_next = 0;
+		idle_left--;
+		if (idle_used[block / 8] & (1 << (block % 8))) continue;
+		if (erasedKnown(block)) continue;
+		if (blockIsBlank(&config, block, buffer, false)) continue;
+		erase_checked = block; // the media's erase() needn't read it again
+		if ((*config.erase)(&config, block) == 0) erased++;
+		erase_checked = (lfs_block_t)-1;
+	}
+#if !LITTLEFS_STATS
+	// without stats_prog() writes can't be seen, traverse on every call
+	free(idle_used);
+	idle_used = nullptr;
+#endif
+	return erased;
+}
+
+// Read a block's first bytes the given number of times, comparing them to
+// pattern each time
+static bool readsBack(struct lfs_config *config, lfs_block_t block,
+  const uint8_t *pattern, uint8_t *buffer, uint32_t times)
+{
+	while (times--) {
+		memset(buffer, 0, config->prog_size);
+		if (config->read(config, block, 0, buffer, config->prog_size) < 0) return false;
+		if (memcmp(buffer, pattern, config->prog_size) != 0) return false;
+	}
+	return true;
+}
+
+// Write a test pattern to the unused block littlefs will allocate last, then
+// read it back at rising clocks up to maxclock, with setclock() changing the
+// media's read clock.  setclock() must only change the clock of the data
+// transfer of reads, so programs, erases and status reads, where a failed
+// transfer could write the wrong place, never run at an untested clock.
+// Returns the fastest clock which read the pattern correctly every time, and
+// leaves the media reading at it, or 0 if there was none.
+FLASHMEM
+uint32_t LittleFS::findClock(uint32_t maxclock, void (*setclock)(const struct lfs_config *c, uint32_t hz))
+{
+	static const uint8_t clock_mhz[] = {10, 20, 30, 40, 50, 60, 70, 80, 90, 100, 110, 120, 133};
+	if (!mounted) return 0;
+	const uint32_t n = config.block_count;
+	const uint32_t size = config.prog_size;
+	uint8_t *used = (uint8_t *)calloc((n + 7) / 8 + size * 2, 1);
+	if (!used) return 0;
+	uint8_t *pattern = used + (n + 7) / 8;
+	uint8_t *buffer = pattern + size;
+	uint32_t block = n;
+	cb_usedBlocks( nullptr, n ); // init and pass MAX block_count
+	if (lfs_fs_traverse(&lfs, cb_usedBlocks, used) >= 0) {
+		const uint32_t alloc = (lfs.free.off + lfs.free.i) % n;
+		for (uint32_t i=1; i <= n && block == n; i++) {
+			const uint32_t b = (alloc + n - i) % n;
+			if (!(used[b / 8] & (1 << (b % 8)))) block = b;
+		}
+	}
+	uint32_t best = 0;
+	if (block < n) {
+		// xorshift, so every bit of every byte changes
+		uint32_t x = micros() | 1;
+		for (uint32_t i=0; i < size; i++) {
+			x ^= x << 13;
+			x ^= x >> 17;
+			x ^= x << 5;
+			pattern[i] = x;
+		}
+		setclock(&config, (maxclock < clock_mhz[0] * 1000000) ? maxclock : clock_mhz[0] * 1000000);
+		if ((*config.erase)(&config, block) == 0
+		  && (*config.prog)(&config, block, 0, pattern, size) == 0
+		  && (*config.sync)(&config) == 0
+		  && readsBack(&config, block, pattern, buffer, 1)) {
+			for (unsigned int i=0; i < sizeof(clock_mhz); i++) {
+				const uint32_t hz = clock_mhz[i] * 1000000;
+				if (hz > maxclock) break;
+				setclock(&config, hz);
+				// repeated, to catch timing which is only just good enough
+				if (!readsBack(&config, block, pattern, buffer, 8)) break;
+				best = hz;
+			}
+			if (best) setclock(&config, best);
+		}
+	}
+	free(used);
+	return best;
+}
+
 FLASHMEM
 bool LittleFS::lowLevelFormat(char progressChar, Print* pr)
 {
@@ -369,7 +1022,9 @@ bool LittleFS::lowLevelFormat(char progressChar, Print* pr)
 	for (unsigned int block=0; block < config.block_count; block++) {
 		if (pr && progressChar && (0 == block%ii) ) pr->write(progressChar);
 		if (!blockIsBlank(&config, block, buffer)) {
+			erase_checked = block;
 			(*config.erase)(&config, block);
+			erase_checked = (lfs_block_t)-1;
 		}
 	}
 	free(buffer);
@@ -403,92 +1058,218 @@ static void printtbuf(const void *buf, unsigned int len)
 int LittleFS_SPIFlash::read(lfs_block_t block, lfs_off_t offset, void *buf, lfs_size_t size)
 {
 	if (!port) return LFS_ERR_IO;
+	const bool suspended = suspend(block);
+	if (!suspended) {
+		int err = finish();
+		if (err) return err;
+	}
 	const uint32_t addr = block * config.block_size + offset;
 	const uint8_t addrbits = ((const struct chipinfo *)hwinfo)->addrbits;
-	const uint8_t cmd = (addrbits == 24) ? 0x03 : 0x13; // standard read command
-	uint8_t cmdaddr[5];
+	uint8_t cmdaddr[6];
 	//Serial.printf("  addrbits=%d\n", addrbits);
-	make_command_and_address(cmdaddr, cmd, addr, addrbits);
-	//printtbuf(cmdaddr, 1 + (addrbits >> 3));
+	make_command_and_address(cmdaddr, readcmd, addr, addrbits);
+	uint32_t len = 1 + (addrbits >> 3);
+	if (readcmd == 0x0B || readcmd == 0x0C) cmdaddr[len++] = 0; // 8 dummy clocks
+	//printtbuf(cmdaddr, len);
 	memset(buf, 0, size);
-	port->beginTransaction(SPICONFIG);
+	port->beginTransaction(SPICONFIG(readclock));
 	digitalWrite(pin, LOW);
-	port->transfer(cmdaddr, 1 + (addrbits >> 3));
+	port->transfer(cmdaddr, len);
 	port->transfer(buf, size);
 	digitalWrite(pin, HIGH);
 	port->endTransaction();
 	//printtbuf(buf, 20);
+	if (suspended) resume();
 	return 0;
 }
 
 int LittleFS_SPIFlash::prog(lfs_block_t block, lfs_off_t offset, const void *buf, lfs_size_t size)
 {
 	if (!port) return LFS_ERR_IO;
-	const uint32_t addr = block * config.block_size + offset;
+	uint32_t addr = block * config.block_size + offset;
 	const uint8_t addrbits = ((const struct chipinfo *)hwinfo)->addrbits;
 	const uint8_t cmd = (addrbits == 24) ? 0x02 : 0x12; // page program
+	const uint32_t pagesize = ((const struct chipinfo *)hwinfo)->progsize;
+	const uint32_t progtime = ((const struct chipinfo *)hwinfo)->progtime;
+	const uint8_t *p = (const uint8_t *)buf;
+	int err = finish();
+	if (err) return err;
+	clearErased(block); // after finish(), which marks a deferred erase's block erased
+	while (size > 0) {
+		// a cache larger than one page is programmed one page at a time
+		lfs_size_t len = pagesize - (addr % pagesize);
+		if (len > size) len = size;
+		uint8_t cmdaddr[5];
+		make_command_and_address(cmdaddr, cmd, addr, addrbits);
+		//printtbuf(cmdaddr, 1 + (addrbits >> 3));
+		port->beginTransaction(SPICONFIG(spiclock));
+		digitalWrite(pin, LOW);
+		port->transfer(0x06); // 0x06 = write enable
+		digitalWrite(pin, HIGH);
+		delayNanoseconds(250);
+		digitalWrite(pin, LOW);
+		port->transfer(cmdaddr, 1 + (addrbits >> 3));
+		port->transfer(p, nullptr, len);
+		digitalWrite(pin, HIGH);
+		port->endTransaction();
+		//printtbuf(p, 20);
+		addr += len;
+		p += len;
+		size -= len;
+		if (defer_wait && size == 0) {
+			busy_us = progtime; // the last page finishes in finish()
+			busy_begin = micros();
+			busy_erase = false;
+			break;
+		}
+		err = wait(progtime, micros(), prog_us);
+		if (err) return err;
+	}
+	return 0;
+}
+
+int LittleFS_SPIFlash::erase(lfs_block_t block)
+{
+	if (!port) return LFS_ERR_IO;
+	int err = finish();
+	if (err) return err;
+	if (blockErased(block)) return 0; // Already formatted exit no wait
+	const uint32_t addr = block * config.block_size;
 	uint8_t cmdaddr[5];
-	make_command_and_address(cmdaddr, cmd, addr, addrbits);
+	const uint8_t addrbits = ((const struct chipinfo *)hwinfo)->addrbits;
+	make_command_and_address(cmdaddr, erasecmd, addr, addrbits);
 	//printtbuf(cmdaddr, 1 + (addrbits >> 3));
-	port->beginTransaction(SPICONFIG);
+	port->beginTransaction(SPICONFIG(spiclock));
 	digitalWrite(pin, LOW);
 	port->transfer(0x06); // 0x06 = write enable
 	digitalWrite(pin, HIGH);
 	delayNanoseconds(250);
 	digitalWrite(pin, LOW);
 	port->transfer(cmdaddr, 1 + (addrbits >> 3));
-	port->transfer(buf, nullptr, size);
 	digitalWrite(pin, HIGH);
 	port->endTransaction();
-	//printtbuf(buf, 20);
-	const uint32_t progtime = ((const struct chipinfo *)hwinfo)->progtime;
-	return wait(progtime);
+	if (defer_wait) {
+		busy_us = erasetime;
+		busy_begin = micros();
+		busy_erase = true;
+		busy_block = block;
+		resume_begin = busy_begin;
+		return 0;
+	}
+	err = wait(erasetime, micros(), erase_us);
+	if (!err) setErased(block);
+	return err;
 }
 
-int LittleFS_SPIFlash::erase(lfs_block_t block)
+// Wait for a program or erase left running by deferred wait mode
+int LittleFS_SPIFlash::finish()
 {
+	if (!busy_us) return 0;
+	const uint32_t microseconds = busy_us;
+	busy_us = 0;
 	if (!port) return LFS_ERR_IO;
-	void *buffer = malloc(config.read_size);
-	if ( buffer != nullptr) {
-		if ( blockIsBlank(&config, block, buffer)) {
-			free(buffer);
-			return 0; // Already formatted exit no wait
-		}
-		free(buffer);
+	int err = wait(microseconds, busy_begin, busy_erase ? erase_us : prog_us);
+	// a suspend which took effect after suspend() gave up leaves the chip
+	// ready with the erase unfinished
+	while (!err && busy_erase && can_suspend && isSuspended()) {
+		resume();
+		err = wait(microseconds, busy_begin, erase_us);
 	}
-	const uint32_t addr = block * config.block_size;
-	uint8_t cmdaddr[5];
-	const uint8_t erasecmd = ((const struct chipinfo *)hwinfo)->erasecmd;
-	const uint8_t addrbits = ((const struct chipinfo *)hwinfo)->addrbits;
-	make_command_and_address(cmdaddr, erasecmd, addr, addrbits);
-	//printtbuf(cmdaddr, 1 + (addrbits >> 3));
-	port->beginTransaction(SPICONFIG);
+	if (!err && busy_erase) setErased(busy_block);
+	return err;
+}
+
+// Winbond and GigaDevice report a suspended erase in bit 7 of status register 2
+bool LittleFS_SPIFlash::isSuspended()
+{
+	port->beginTransaction(SPICONFIG(spiclock));
 	digitalWrite(pin, LOW);
-	port->transfer(0x06); // 0x06 = write enable
+	const uint16_t status = port->transfer16(0x3500); // 0x35 = get status register 2
 	digitalWrite(pin, HIGH);
-	delayNanoseconds(250);
+	port->endTransaction();
+	return status & 0x80;
+}
+
+// Suspend an unfinished erase, so a read of another block needn't wait for
+// it.  Returns false, and the caller must finish() instead, when there's no
+// erase to suspend, it's on the block being read, or the chip can't.
+bool LittleFS_SPIFlash::suspend(lfs_block_t block)
+{
+	if (!busy_us || !busy_erase || block == busy_block || !can_suspend) return false;
+	// give the erase some time to run between suspends, so it still ends
+	while (micros() - resume_begin < SUSPEND_MIN_US) yield();
+	suspend_begin = micros();
+	port->beginTransaction(SPICONFIG(spiclock));
 	digitalWrite(pin, LOW);
-	port->transfer(cmdaddr, 1 + (addrbits >> 3));
+	port->transfer(0x75); // 0x75 = erase/program suspend
+	digitalWrite(pin, HIGH);
+	port->endTransaction();
+	while (1) {
+		// only a poll started after the time is up may time out
+		const bool late = micros() - suspend_begin > SUSPEND_TIMEOUT_US;
+		port->beginTransaction(SPICONFIG(spiclock));
+		digitalWrite(pin, LOW);
+		const uint16_t status = port->transfer16(0x0500); // 0x05 = get status
+		digitalWrite(pin, HIGH);
+		port->endTransaction();
+		if (!(status & 1)) break;
+		if (late) {
+			// the chip may still suspend, resume is ignored if it hasn't
+			resume();
+			return false;
+		}
+	}
+	if (!isSuspended()) {
+		// the erase had ended, resume in case the suspend was only late
+		resume();
+		return false;
+	}
+	return true;
+}
+
+// Resume a suspended erase.  The time since suspend() doesn't count
+// towards the erase timeout.
+void LittleFS_SPIFlash::resume()
+{
+	port->beginTransaction(SPICONFIG(spiclock));
+	digitalWrite(pin, LOW);
+	port->transfer(0x7A); // 0x7A = erase/program resume
 	digitalWrite(pin, HIGH);
 	port->endTransaction();
-	const uint32_t erasetime = ((const struct chipinfo *)hwinfo)->erasetime;
-	return wait(erasetime);
+	resume_begin = micros();
+	busy_begin += resume_begin - suspend_begin;
+	// a suspend which takes effect after this resume is counted from here,
+	// when finish() resumes it
+	suspend_begin = resume_begin;
 }
 
-int LittleFS_SPIFlash::wait(uint32_t microseconds)
+// Wait for the chip to finish an operation started at begin_us.  The first
+// status poll is at 3/4 of the time recent operations took, then polls back
+// off exponentially, leaving the bus free for other devices in between.
+int LittleFS_SPIFlash::wait(uint32_t microseconds, uint32_t begin_us, uint32_t &typical_us)
 {
-	elapsedMicros usec = 0;
+	uint32_t next = typical_us - typical_us / 4;
+	if (next > microseconds / 2) next = microseconds / 2;
+	uint32_t interval = POLL_MIN_US;
+	const uint32_t max_interval = typical_us ? typical_us / 8 : microseconds / 64;
+	bool waited = false;
 	while (1) {
-		port->beginTransaction(SPICONFIG);
+		while (micros() - begin_us < next) yield();
+		// only a poll started after the time is up may time out
+		const uint32_t us = micros() - begin_us;
+		port->beginTransaction(SPICONFIG(spiclock));
 		digitalWrite(pin, LOW);
 		uint16_t status = port->transfer16(0x0500); // 0x05 = get status
 		digitalWrite(pin, HIGH);
 		port->endTransaction();
 		if (!(status & 1)) break;
-		if (usec > microseconds) return LFS_ERR_IO; // timeout
-		yield();
+		if (us > microseconds) return LFS_ERR_IO; // timeout
+		waited = true;
+		next = us + interval;
+		if (interval < max_interval) interval *= 2;
 	}
-	//Serial.printf("  waited %u us\n", (unsigned int)usec);
+	typical_us = learn_typical(typical_us, micros() - begin_us, waited);
+	//Serial.printf("  waited %u us\n", (unsigned int)(micros() - begin_us));
 	return 0; // success
 }
 
@@ -505,7 +1286,7 @@ int LittleFS_SPIFram::read(lfs_block_t block, lfs_off_t offset, void *buf, lfs_s
 	const uint8_t addrbits = ((const struct chipinfo *)hwinfo)->addrbits;
 	make_command_and_address(cmdaddr, 0x03, addr, addrbits);
 	memset(buf, 0, size);
-	port->beginTransaction(SPICONFIG);
+	port->beginTransaction(SPICONFIG(readclock));
 	digitalWrite(pin,LOW);                     //chip select
 	port->transfer(cmdaddr, 1 + (addrbits >> 3));
 	port->transfer(buf, size);
@@ -519,6 +1300,7 @@ int LittleFS_SPIFram::read(lfs_block_t block, lfs_off_t offset, void *buf, lfs_s
 int LittleFS_SPIFram::prog(lfs_block_t block, lfs_off_t offset, const void *buf, lfs_size_t size)
 {
 	if (!port) return LFS_ERR_IO;
+	clearErased(block);
 	const uint32_t addr = block * config.block_size + offset;
 
 	// F-RAM WRITE ENABLE COMMAND
@@ -527,7 +1309,7 @@ int LittleFS_SPIFram::prog(lfs_block_t block, lfs_off_t offset, const void *buf,
 	//Serial.printf("  addrbits=%d\n", addrbits);
 	make_command_and_address(cmdaddr, 0x02, addr, addrbits);
   
-	port->beginTransaction(SPICONFIG);
+	port->beginTransaction(SPICONFIG(spiclock));
 	digitalWrite(pin,LOW);  //chip select
 	delayNanoseconds(50);
 	port->transfer(0x06);    //transmit write enable opcode
@@ -547,14 +1329,7 @@ int LittleFS_SPIFram::prog(lfs_block_t block, lfs_off_t offset, const void *buf,
 int LittleFS_SPIFram::erase(lfs_block_t block)
 {
 	if (!port) return LFS_ERR_IO;
-	void *buffer = malloc(config.read_size);
-	if ( buffer != nullptr) {
-		if ( blockIsBlank(&config, block, buffer)) {
-			free(buffer);
-			return 0; // Already formatted exit no wait
-		}
-		free(buffer);
-	}
+	if (blockErased(block)) return 0; // Already formatted exit no wait
 	//Serial.printf("  flash er: block=%d\n", block);
 	uint8_t buf[256];
 	//for(uint32_t i = 0; i < config.block_size; i++) buf[i] = 0xFF;
@@ -565,7 +1340,7 @@ int LittleFS_SPIFram::erase(lfs_block_t block)
 	make_command_and_address(cmdaddr, 0x02, addr, addrbits);
 	
 	// F-RAM WRITE ENABLE COMMAND
-	port->beginTransaction(SPICONFIG);
+	port->beginTransaction(SPICONFIG(spiclock));
 	digitalWrite(pin,LOW);  //chip select
 	port->transfer(0x06);    //transmit write enable opcode
 	digitalWrite(pin,HIGH); //release chip, signal end transfer
@@ -578,7 +1353,7 @@ int LittleFS_SPIFram::erase(lfs_block_t block)
 	port->transfer(buf, nullptr, config.block_size);
 	digitalWrite(pin,HIGH);                  //release chip, signal end of transfer
 	port->endTransaction();
-	
+	setErased(block);
 	return 0;
 }
 
@@ -606,6 +1381,8 @@ int LittleFS_SPIFram::wait(uint32_t microseconds)
 #define READ_SDR        FLEXSPI_LUT_OPCODE_READ_SDR
 #define WRITE_SDR       FLEXSPI_LUT_OPCODE_WRITE_SDR
 #define DUMMY_SDR       FLEXSPI_LUT_OPCODE_DUMMY_SDR
+#define MODE4_SDR       FLEXSPI_LUT_OPCODE_MODE4_SDR
+#define MODE8_SDR       FLEXSPI_LUT_OPCODE_MODE8_SDR
 #define PINS1           FLEXSPI_LUT_NUM_PADS_1
 #define PINS4           FLEXSPI_LUT_NUM_PADS_4
 
@@ -727,7 +1504,7 @@ static void flexspi2_ip_write(uint32_t index, uint32_t addr, const void *data, u
 
 
 FLASHMEM
-bool LittleFS_QSPIFlash::begin()
+bool LittleFS_QSPIFlash::begin(uint32_t cacheSize, uint32_t blockSize)
 {
 	// Workaround for strange compatibility problem with Wire (and likely other libs)
 	// https://github.com/PaulStoffregen/LittleFS/issues/63
@@ -748,8 +1525,18 @@ bool LittleFS_QSPIFlash::begin()
 
 	//Serial.printf("Flash ID: %02X %02X %02X\n", buf[0], buf[1], buf[2]);
 	const struct chipinfo *info = chip_lookup(buf);
-	if (!info) return false;
+	if (!info) {
+		// not a known chip, try describing it from its SFDP table
+		if (!sfdp_info) sfdp_info = malloc(sizeof(struct chipinfo));
+		if (!sfdp_info) return false;
+		if (!sfdp_chipinfo((struct chipinfo *)sfdp_info, buf, &static_sfdp, this)) return false;
+		info = (const struct chipinfo *)sfdp_info;
+	}
+	const uint32_t block_size = blockSize ? blockSize : info->erasesize;
+	if (!erase_for(info, block_size, &erasecmd, &erasetime)) return false;
 	hwinfo = info;
+	prog_us = 0;
+	erase_us = 0;
 	//Serial.printf("Flash size is %.2f Mbyte\n", (float)info->chipsize / 1048576.0f);
 
 	memset(&lfs, 0, sizeof(lfs));
@@ -759,12 +1546,14 @@ bool LittleFS_QSPIFlash::begin()
 	config.prog = &static_prog;
 	config.erase = &static_erase;
 	config.sync = &static_sync;
+	erase_time_us = erasetime;
+	attachStats();
 	config.read_size = info->progsize;
 	config.prog_size = info->progsize;
-	config.block_size = info->erasesize;
-	config.block_count = info->chipsize / info->erasesize;
+	config.block_size = block_size;
+	config.block_count = info->chipsize / block_size;
 	config.block_cycles = 400;
-	config.cache_size = info->progsize;
+	config.cache_size = cache_size_for(info, block_size, cacheSize);
 	config.lookahead_size = info->progsize;
 	//config.lookahead_size = config.block_count/8;
 	config.name_max = LFS_NAME_MAX;
@@ -785,14 +1574,29 @@ bool LittleFS_QSPIFlash::begin()
 
 	if (info->addrbits == 24) {
 		// cmd index 9 = read QSPI (1-1-4)
-		FLEXSPI2_LUT36 = LUT0(CMD_SDR, PINS1, 0x6B) | LUT1(ADDR_SDR, PINS1, 24);
-		FLEXSPI2_LUT37 = LUT0(DUMMY_SDR, PINS4, 8) |  LUT1(READ_SDR, PINS4, 1);
-		FLEXSPI2_LUT38 = 0;
+		const uint8_t readcmd = info->quadread ? info->quadread : 0x6B;
+		uint8_t dummy = info->quadread ? info->quaddummy : 8;
+		const uint8_t mode = info->quadread ? info->quadmode : 0;
+		uint32_t seq[4] = {0, 0, 0, 0};
+		int n = 0;
+		// mode bits all 1, which no chip takes as continuous read mode.
+		// Mode cycles past the 8 bits are sent as dummy cycles.
+		if (mode == 1) {
+			seq[n++] = LUT0(MODE4_SDR, PINS4, 0x0F);
+		} else if (mode >= 2) {
+			seq[n++] = LUT0(MODE8_SDR, PINS4, 0xFF);
+			dummy += mode - 2;
+		}
+		if (dummy) seq[n++] = LUT0(DUMMY_SDR, PINS4, dummy);
+		seq[n++] = LUT0(READ_SDR, PINS4, 1);
+		FLEXSPI2_LUT36 = LUT0(CMD_SDR, PINS1, readcmd) | LUT1(ADDR_SDR, PINS1, 24);
+		FLEXSPI2_LUT37 = seq[0] | (seq[1] << 16);
+		FLEXSPI2_LUT38 = seq[2] | (seq[3] << 16);
 		// cmd index 11 = program QSPI (1-1-4)
 		FLEXSPI2_LUT44 = LUT0(CMD_SDR, PINS1, 0x32) | LUT1(ADDR_SDR, PINS1, 24);
 		FLEXSPI2_LUT45 = LUT0(WRITE_SDR, PINS4, 1);
 		// cmd index 12 = sector erase
-		FLEXSPI2_LUT48 = LUT0(CMD_SDR, PINS1, info->erasecmd) | LUT1(ADDR_SDR, PINS1, 24);
+		FLEXSPI2_LUT48 = LUT0(CMD_SDR, PINS1, erasecmd) | LUT1(ADDR_SDR, PINS1, 24);
 		FLEXSPI2_LUT49 = 0;
 	} else {
 		// cmd index 9 = read QSPI (1-1-4)
@@ -803,7 +1607,7 @@ bool LittleFS_QSPIFlash::begin()
 		FLEXSPI2_LUT44 = LUT0(CMD_SDR, PINS1, 0x34) | LUT1(ADDR_SDR, PINS1, 32);
 		FLEXSPI2_LUT45 = LUT0(WRITE_SDR, PINS4, 1);
 		// cmd index 12 = sector erase
-		FLEXSPI2_LUT48 = LUT0(CMD_SDR, PINS1, info->erasecmd) | LUT1(ADDR_SDR, PINS1, 32);
+		FLEXSPI2_LUT48 = LUT0(CMD_SDR, PINS1, erasecmd) | LUT1(ADDR_SDR, PINS1, 32);
 		FLEXSPI2_LUT49 = 0;
 		// cmd index 9 = read SPI (1-1-1)
 		//FLEXSPI2_LUT36 = LUT0(CMD_SDR, PINS1, 0x13) | LUT1(ADDR_SDR, PINS1, 32);
@@ -848,44 +1652,61 @@ int LittleFS_QSPIFlash::read(lfs_block_t block, lfs_off_t offset, void *buf, lfs
 
 int LittleFS_QSPIFlash::prog(lfs_block_t block, lfs_off_t offset, const void *buf, lfs_size_t size)
 {
-	flexspi2_ip_command(10, 0);
-	const uint32_t addr = block * config.block_size + offset;
-	//printtbuf(buf, 20);
-	flexspi2_ip_write(11, addr, buf, size);
-	// TODO: detect errors, return LFS_ERR_IO
+	clearErased(block);
+	uint32_t addr = block * config.block_size + offset;
+	const uint32_t pagesize = ((const struct chipinfo *)hwinfo)->progsize;
 	const uint32_t progtime = ((const struct chipinfo *)hwinfo)->progtime;
-	return wait(progtime);
+	const uint8_t *p = (const uint8_t *)buf;
+	while (size > 0) {
+		// a cache larger than one page is programmed one page at a time
+		lfs_size_t len = pagesize - (addr % pagesize);
+		if (len > size) len = size;
+		flexspi2_ip_command(10, 0);
+		//printtbuf(p, 20);
+		flexspi2_ip_write(11, addr, p, len);
+		// TODO: detect errors, return LFS_ERR_IO
+		int err = wait(progtime, micros(), prog_us);
+		if (err) return err;
+		addr += len;
+		p += len;
+		size -= len;
+	}
+	return 0;
 }
 
 int LittleFS_QSPIFlash::erase(lfs_block_t block)
 {
-	void *buffer = malloc(config.read_size);
-	if ( buffer != nullptr) {
-		if ( blockIsBlank(&config, block, buffer)) {
-			free(buffer);
-			return 0; // Already formatted exit no wait
-		}
-		free(buffer);
-	}
+	if (blockErased(block)) return 0; // Already formatted exit no wait
 	flexspi2_ip_command(10, 0);
 	const uint32_t addr = block * config.block_size;
 	flexspi2_ip_command(12, addr);
 	// TODO: detect errors, return LFS_ERR_IO
-	const uint32_t erasetime = ((const struct chipinfo *)hwinfo)->erasetime;
-	return wait(erasetime);
+	int err = wait(erasetime, micros(), erase_us);
+	if (!err) setErased(block);
+	return err;
 }
 
-int LittleFS_QSPIFlash::wait(uint32_t microseconds)
+int LittleFS_QSPIFlash::wait(uint32_t microseconds, uint32_t begin_us, uint32_t &typical_us)
 {
-	elapsedMicros usec = 0;
+	uint32_t next = typical_us - typical_us / 4;
+	if (next > microseconds / 2) next = microseconds / 2;
+	uint32_t interval = POLL_MIN_US;
+	const uint32_t max_interval = typical_us ? typical_us / 8 : microseconds / 64;
+	bool waited = false;
 	while (1) {
+		while (micros() - begin_us < next) yield();
+		// only a poll started after the time is up may time out
+		const uint32_t us = micros() - begin_us;
 		uint8_t status;
 		flexspi2_ip_read(13, 0, &status, 1);
 		if (!(status & 1)) break;
-		if (usec > microseconds) return LFS_ERR_IO; // timeout
-		yield();
+		if (us > microseconds) return LFS_ERR_IO; // timeout
+		waited = true;
+		next = us + interval;
+		if (interval < max_interval) interval *= 2;
 	}
-	//Serial.printf("  waited %u us\n", (unsigned int)usec);
+	typical_us = learn_typical(typical_us, micros() - begin_us, waited);
+	//Serial.printf("  waited %u us\n", (unsigned int)(micros() - begin_us));
 	return 0; // success
 }
 
@@ -896,6 +1717,23 @@ const char * LittleFS_QSPIFlash::getMediaName(){
 	return ((const struct chipinfo *)hwinfo)->pn;
 }
 
+FLASHMEM
+void LittleFS_QSPIFlash::readSFDP(uint32_t addr, void *buf, uint32_t len)
+{
+	FLEXSPI2_LUTKEY = FLEXSPI_LUTKEY_VALUE;
+	FLEXSPI2_LUTCR = FLEXSPI_LUTCR_UNLOCK;
+	// cmd index 8 = read SFDP, 24 bit address, 8 dummy clocks, put back
+	// afterwards for whatever else uses it
+	const uint32_t lut[3] = {FLEXSPI2_LUT32, FLEXSPI2_LUT33, FLEXSPI2_LUT34};
+	FLEXSPI2_LUT32 = LUT0(CMD_SDR, PINS1, 0x5A) | LUT1(ADDR_SDR, PINS1, 24);
+	FLEXSPI2_LUT33 = LUT0(DUMMY_SDR, PINS1, 8) | LUT1(READ_SDR, PINS1, 1);
+	FLEXSPI2_LUT34 = 0;
+	flexspi2_ip_read(8, addr, buf, len);
+	FLEXSPI2_LUT32 = lut[0];
+	FLEXSPI2_LUT33 = lut[1];
+	FLEXSPI2_LUT34 = lut[2];
+}
+
 
 #endif // __IMXRT1062__
 
@@ -947,6 +1785,8 @@ bool LittleFS_Program::begin(uint32_t size)
 	config.prog = &static_prog;
 	config.erase = &static_erase;
 	config.sync = &static_sync;
+	erase_time_us = 2000000; // maximum for a 32K or 64K sector
+	attachStats();
 	config.read_size = 128;
 	config.prog_size = 128;
 	config.block_size = SECTOR_SIZE;
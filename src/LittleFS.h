@@ -27,6 +27,45 @@
 #include "littlefs/lfs.h"
 //#include <algorithm>
 
+// An open file.  Its cache buffer is given to littlefs in config.  For a
+// file opened for writing, the creation and modification times are file
+// attributes, written by the same metadata commit as its data when the
+// file is flushed or closed.
+typedef struct {
+	lfs_file_t file; // first, so the lfs_file_t is the whole handle
+	struct lfs_file_config config;
+	struct lfs_attr attrs[2];
+	uint32_t ctime;
+	uint32_t mtime;
+} LittleFS_FileHandle;
+
+// Open files and directories, their handles and file cache buffers come
+// from fixed pools, so opening and closing files on a long running logger
+// doesn't fragment the heap.  When a pool is used up, or a cache is larger
+// than LITTLEFS_POOL_CACHE_SIZE, malloc is used instead.  Define
+// LITTLEFS_POOL_FILES as 0 to always use malloc.
+#ifndef LITTLEFS_POOL_FILES
+#define LITTLEFS_POOL_FILES 4
+#endif
+#ifndef LITTLEFS_POOL_CACHE_SIZE
+#define LITTLEFS_POOL_CACHE_SIZE 256
+#endif
+#define LITTLEFS_POOL_OBJECT  0   // LittleFSFile
+#define LITTLEFS_POOL_HANDLE  1   // LittleFS_FileHandle or lfs_dir_t
+#define LITTLEFS_POOL_CACHE   2   // file cache buffer
+
+typedef struct {
+	uint32_t in_use;        // allocated now, from the pool or the heap
+	uint32_t high_water;    // most allocated at once
+	uint32_t heap;          // allocations the pool couldn't hold
+} LittleFS_PoolCounter;
+
+typedef struct {
+	LittleFS_PoolCounter objects;
+	LittleFS_PoolCounter handles;
+	LittleFS_PoolCounter caches;
+} LittleFS_PoolStats;
+
 class LittleFSFile : public FileImpl
 {
 private:
@@ -39,6 +78,7 @@ private:
 		file = filein;
 		dir = nullptr;
 		strlcpy(fullpath, name, sizeof(fullpath));
+		lfs_file_setindex(lfs, file, index_small, sizeof(index_small));
 		//Serial.printf("  LittleFSFile ctor (file), this=%x\n", (int)this);
 	}
 	LittleFSFile(lfs_t *lfsin, lfs_dir_t *dirin, const char *name) {
@@ -48,8 +88,72 @@ private:
 		strlcpy(fullpath, name, sizeof(fullpath));
 		//Serial.printf("  LittleFSFile ctor (dir), this=%x\n", (int)this);
 	}
+	static LittleFSFile * openFile(lfs_t *lfs, const char *path, int flags) {
+		LittleFS_FileHandle *h = (LittleFS_FileHandle *)poolAlloc(
+			LITTLEFS_POOL_HANDLE, sizeof(LittleFS_FileHandle));
+		if (!h) return nullptr;
+		memset(&h->config, 0, sizeof(h->config));
+		h->config.buffer = poolAlloc(LITTLEFS_POOL_CACHE, lfs->cfg->cache_size);
+		if (!h->config.buffer) {
+			poolFree(LITTLEFS_POOL_HANDLE, h);
+			return nullptr;
+		}
+		uint32_t _now = 0;
+		if (flags & LFS_O_WRONLY) {
+			//attributes get written when the file is closed, in the same
+			//commit as its data.  Opening reads the stored creation time,
+			//if the file has one.
+			_now = Teensy3Clock.get();
+			h->attrs[0] = {'c', &h->ctime, sizeof(h->ctime)};
+			h->attrs[1] = {'m', &h->mtime, sizeof(h->mtime)};
+			h->config.attrs = h->attrs;
+			h->config.attr_count = 2;
+			h->ctime = _now;
+		}
+		if (lfs_file_opencfg(lfs, &h->file, path, flags, &h->config) < 0) {
+			poolFree(LITTLEFS_POOL_CACHE, h->config.buffer);
+			poolFree(LITTLEFS_POOL_HANDLE, h);
+			return nullptr;
+		}
+		if (flags & LFS_O_WRONLY) {
+			if (h->ctime == 0) h->ctime = _now;
+			h->mtime = _now;
+		}
+		LittleFSFile *f = new LittleFSFile(lfs, &h->file, path);
+		if (!f) closeFile(lfs, &h->file);
+		return f;
+	}
+	static void closeFile(lfs_t *lfs, lfs_file_t *file) {
+		lfs_file_close(lfs, file);
+		poolFree(LITTLEFS_POOL_CACHE, file->cfg->buffer);
+		poolFree(LITTLEFS_POOL_HANDLE, file);
+	}
+	static LittleFSFile * openDirectory(lfs_t *lfs, const char *path) {
+		lfs_dir_t *d = (lfs_dir_t *)poolAlloc(LITTLEFS_POOL_HANDLE, sizeof(lfs_dir_t));
+		if (!d) return nullptr;
+		if (lfs_dir_open(lfs, d, path) < 0) {
+			poolFree(LITTLEFS_POOL_HANDLE, d);
+			return nullptr;
+		}
+		LittleFSFile *f = new LittleFSFile(lfs, d, path);
+		if (!f) {
+			lfs_dir_close(lfs, d);
+			poolFree(LITTLEFS_POOL_HANDLE, d);
+		}
+		return f;
+	}
+	static void * poolAlloc(int pool, size_t size);
+	static void poolFree(int pool, void *ptr);
+	static LittleFS_PoolCounter & poolCounter(int pool);
+	static LittleFS_PoolStats pool_stats;
 	friend class LittleFS;
 public:
+	static void * operator new(size_t size) noexcept {
+		return poolAlloc(LITTLEFS_POOL_OBJECT, size);
+	}
+	static void operator delete(void *ptr) {
+		poolFree(LITTLEFS_POOL_OBJECT, ptr);
+	}
 	virtual ~LittleFSFile() {
 		//Serial.printf("  LittleFSFile dtor, this=%x\n", (int)this);
 		close();
@@ -72,6 +176,10 @@ public:
 		if (tm.year < 80 || tm.year > 207) return false;
 		bool success = true;
 		uint32_t mdt = makeTime(tm);
+		if (writeFile()) {
+			writeFile()->ctime = mdt;
+			return true;
+		}
 		int rcode = lfs_setattr(lfs, name(), 'c', (const void *) &mdt, sizeof(mdt));
 		if(rcode < 0)
 			success = false;
@@ -81,6 +189,10 @@ public:
 		if (tm.year < 80 || tm.year > 207) return false;
 		bool success = true;
 		uint32_t mdt = makeTime(tm);
+		if (writeFile()) {
+			writeFile()->mtime = mdt;
+			return true;
+		}
 		int rcode = lfs_setattr(lfs, name(), 'm', (const void *) &mdt, sizeof(mdt));
 		if(rcode < 0) 
 			success = false;
@@ -119,6 +231,24 @@ public:
 		if (lfs_file_truncate(lfs, file, size) >= 0) return true;
 		return false;
 	}
+	// Read the file's list of blocks once, so reading from any position
+	// afterward reads at most one or two blocks to find it.  entries is
+	// how many block addresses (4 bytes each) to keep, 0 for every block.
+	bool buildIndex(uint32_t entries=0) {
+		if (!file) return false;
+		if (entries == 0) {
+			lfs_soff_t size = lfs_file_size(lfs, file);
+			if (size < 0) return false;
+			entries = size / (lfs->cfg->block_size - 2*4) + 1;
+		}
+		if (entries > sizeof(index_small) / sizeof(lfs_block_t)) {
+			lfs_block_t *buf = (lfs_block_t *)realloc(index, entries * sizeof(lfs_block_t));
+			if (!buf) return false;
+			index = buf;
+			lfs_file_setindex(lfs, file, index, entries * sizeof(lfs_block_t));
+		}
+		return lfs_file_buildindex(lfs, file) >= 0;
+	}
 	virtual bool seek(uint64_t pos, int mode = SeekSet) {
 		if (!file) return false;
 		int whence;
@@ -144,14 +274,15 @@ public:
 	virtual void close() {
 		if (file) {
 			//Serial.printf("  close file, this=%x, lfs=%x", (int)this, (int)lfs);
-			lfs_file_close(lfs, file); // we get stuck here, but why?
-			free(file);
+			closeFile(lfs, file); // we get stuck here, but why?
 			file = nullptr;
+			free(index);
+			index = nullptr;
 		}
 		if (dir) {
 			//Serial.printf("  close dir, this=%x, lfs=%x", (int)this, (int)lfs);
 			lfs_dir_close(lfs, dir);
-			free(dir);
+			poolFree(LITTLEFS_POOL_HANDLE, dir);
 			dir = nullptr;
 		}
 		//Serial.println("  end of close");
@@ -186,21 +317,10 @@ public:
 		strlcpy(pathname + len, info.name, sizeof(pathname) - len);
 		//Serial.print("ONF:: pathname --- "); Serial.println(pathname);
 		if (info.type == LFS_TYPE_REG) {
-			lfs_file_t *f = (lfs_file_t *)malloc(sizeof(lfs_file_t));
-			if (!f) return File();
-			if (lfs_file_open(lfs, f, pathname, LFS_O_RDONLY) >= 0) {
-				return File(new LittleFSFile(lfs, f, pathname));
-			}
-			free(f);
+			return File(openFile(lfs, pathname, LFS_O_RDONLY));
 		} else { // LFS_TYPE_DIR
-			lfs_dir_t *d = (lfs_dir_t *)malloc(sizeof(lfs_dir_t));
-			if (!d) return File();
-			if (lfs_dir_open(lfs, d, pathname) >= 0) {
-				return File(new LittleFSFile(lfs, d, pathname));
-			}
-			free(d);
+			return File(openDirectory(lfs, pathname));
 		}
-		return File();
 	}
 	virtual void rewindDirectory(void) {
 		if (dir) lfs_dir_rewind(lfs, dir);
@@ -212,8 +332,17 @@ private:
 	lfs_dir_t *dir;
 	char *filename;
 	char fullpath[128];
+	// block addresses remembered as the file is read, see buildIndex()
+	lfs_block_t index_small[16];
+	lfs_block_t *index = nullptr;
 	
+	// files opened for writing keep their times until closed
+	LittleFS_FileHandle * writeFile() {
+		if (!file || !(file->flags & LFS_O_WRONLY)) return nullptr;
+		return (LittleFS_FileHandle *)file;
+	}
 	uint32_t getCreationTime() {
+		if (writeFile()) return writeFile()->ctime;
 		uint32_t filetime = 0;
 		int rc = lfs_getattr(lfs, fullpath, 'c', (void *)&filetime, sizeof(filetime));
 		if(rc != sizeof(filetime))
@@ -221,6 +350,7 @@ private:
 		return filetime;
 	}
 	uint32_t getModifiedTime() {
+		if (writeFile()) return writeFile()->mtime;
 		uint32_t filetime = 0;
 		int rc = lfs_getattr(lfs, fullpath, 'm', (void *)&filetime, sizeof(filetime));
 		if(rc != sizeof(filetime)) 
@@ -231,7 +361,99 @@ private:
 };
 
 
+// Block device I/O statistics.  Every read, prog, erase and sync littlefs
+// asks of the media is counted.  Define LITTLEFS_STATS as 0 to leave the
+// counting out, getStats() then always returns zeros.
+#ifndef LITTLEFS_STATS
+#define LITTLEFS_STATS 1
+#endif
+
+typedef struct {
+	uint32_t count;         // number of calls
+	uint64_t bytes;         // bytes read, programmed or erased
+	uint64_t total_us;      // total time spent in these calls
+	uint32_t max_us;        // longest single call
+} LittleFS_IOCounter;
+
+typedef struct {
+	LittleFS_IOCounter read;
+	LittleFS_IOCounter prog;
+	LittleFS_IOCounter erase;
+	LittleFS_IOCounter sync;
+	uint32_t erase_skipped; // erases not sent to the chip, block was already blank
+} LittleFS_IOStats;
+
+// Block operation trace.  Each read, prog, erase and sync is recorded as
+// one fixed size record, so a trace can be saved and replayed later.
+#define LITTLEFS_TRACE_READ   1
+#define LITTLEFS_TRACE_PROG   2
+#define LITTLEFS_TRACE_ERASE  3
+#define LITTLEFS_TRACE_SYNC   4
 
+typedef struct {
+	uint32_t us;            // micros() when the operation started
+	uint32_t duration_us;   // time the media took
+	uint32_t block;
+	uint32_t offset;
+	uint32_t size;          // bytes, block size for erase, zero for sync
+	uint8_t  op;            // LITTLEFS_TRACE_READ, _PROG, _ERASE or _SYNC
+	int8_t   err;           // result returned to littlefs
+	uint16_t reserved;
+} LittleFS_TraceRecord;
+
+// One directory entry, as read by LittleFSDir
+typedef struct {
+	char name[LFS_NAME_MAX+1];
+	uint8_t type;           // LFS_TYPE_REG or LFS_TYPE_DIR
+	uint32_t size;          // file size in bytes, 0 for directories
+	uint32_t ctime;         // creation time, 0 if not read or never set
+	uint32_t mtime;         // modification time, 0 if not read or never set
+} LittleFS_DirEntry;
+
+// Lists a directory without opening its entries.  Each entry's name, type,
+// size and optionally its times are read straight from the directory's
+// metadata, with no path lookup or memory allocated per entry.  Opened by
+// LittleFS::openDir().
+class LittleFSDir
+{
+public:
+	LittleFSDir() { }
+	~LittleFSDir() { close(); }
+	bool read(LittleFS_DirEntry &entry, bool times=false) {
+		if (!lfs) return false;
+		struct lfs_info info;
+		do {
+			if (lfs_dir_read(lfs, &dir, &info) <= 0) return false;
+		} while (strcmp(info.name, ".") == 0 || strcmp(info.name, "..") == 0);
+		memcpy(entry.name, info.name, sizeof(entry.name));
+		entry.type = info.type;
+		entry.size = (info.type == LFS_TYPE_REG) ? info.size : 0;
+		entry.ctime = 0;
+		entry.mtime = 0;
+		if (times) {
+			if (lfs_dir_getattr(lfs, &dir, 'c', &entry.ctime, sizeof(entry.ctime))
+			  != sizeof(entry.ctime)) entry.ctime = 0;
+			if (lfs_dir_getattr(lfs, &dir, 'm', &entry.mtime, sizeof(entry.mtime))
+			  != sizeof(entry.mtime)) entry.mtime = 0;
+		}
+		return true;
+	}
+	void rewind() {
+		if (lfs) lfs_dir_rewind(lfs, &dir);
+	}
+	void close() {
+		if (lfs) lfs_dir_close(lfs, &dir);
+		lfs = nullptr;
+	}
+	bool isOpen() { return lfs != nullptr; }
+private:
+	// dir is linked into littlefs's list of open dirs, so it can't be copied
+	LittleFSDir(const LittleFSDir &) = delete;
+	LittleFSDir & operator=(const LittleFSDir &) = delete;
+	lfs_t *lfs = nullptr;
+	lfs_dir_t dir;
+	friend class LittleFS;
+};
 
 class LittleFS : public FS
 {
@@ -252,8 +474,38 @@ public:
 	bool quickFormat();
 	bool lowLevelFormat(char progressChar=0, Print* pr=&Serial);
 	uint32_t formatUnused(uint32_t blockCnt, uint32_t blockStart);
+	// Erase unused blocks for up to budget_us microseconds, for calling
+	// when the program is idle so later writes don't wait for erases.
+	// Continues where the last call stopped, starting with the blocks
+	// littlefs will allocate next.  Until an erase has been timed, each
+	// is assumed to take the chip's maximum erase time.  Returns the
+	// number of blocks erased.
+	uint32_t idleErase(uint32_t budget_us);
+	// Extra read cache lines, each one cache size, for media which is slow
+	// to read.  Call after begin(), before files are opened.  The second
+	// form uses a caller supplied buffer, for example in DMAMEM or EXTMEM.
+	// This and the three setters below remount the filesystem, so they
+	// return false while any file or directory is open.
+	bool setReadCache(uint32_t lines) { return readCache(lines, nullptr); }
+	bool setReadCache(void *buffer, uint32_t size) {
+		return readCache(config.cache_size ? size / config.cache_size : 0, buffer);
+	}
+	// Keep one allocation bitmap for the whole media, one bit per block,
+	// so littlefs only scans the filesystem for free blocks after it has
+	// used every free block once.  Call after begin(), before files are
+	// opened.  The second form uses a caller supplied buffer of at least
+	// block count / 8 bytes.
+	bool setAllocBitmap() { return allocBitmap(nullptr, 0); }
+	bool setAllocBitmap(void *buffer, uint32_t size) { return allocBitmap(buffer, size); }
+	// Remember the most recently used directory blocks, about 32 bytes
+	// each, so opening files by path doesn't read and check them again
+	// until they change.  Call after begin(), before files are opened.
+	bool setDirCache(uint32_t entries);
+	// Remember where recently opened paths are, about 80 bytes each, so
+	// finding them again doesn't search every directory in the path.
+	// Call after begin(), before files are opened.
+	bool setPathCache(uint32_t entries);
 	File open(const char *filepath, uint8_t mode = FILE_READ) {
-		int rcode;
 		//Serial.println("LittleFS open");
 		if (!mounted) return File();
 		if (mode == FILE_READ) {
@@ -261,43 +513,34 @@ public:
 			if (lfs_stat(&lfs, filepath, &info) < 0) return File();
 			//Serial.printf("LittleFS open got info, name=%s\n", info.name);
 			if (info.type == LFS_TYPE_REG) {
-				lfs_file_t *file = (lfs_file_t *)malloc(sizeof(lfs_file_t));
-				if (!file) return File();
-				if (lfs_file_open(&lfs, file, filepath, LFS_O_RDONLY) >= 0) {
-					return File(new LittleFSFile(&lfs, file, filepath));
-				}
-				free(file);
+				return File(LittleFSFile::openFile(&lfs, filepath, LFS_O_RDONLY));
 			} else { // LFS_TYPE_DIR
-				lfs_dir_t *dir = (lfs_dir_t *)malloc(sizeof(lfs_dir_t));
-				if (!dir) return File();
-				if (lfs_dir_open(&lfs, dir, filepath) >= 0) {
-					return File(new LittleFSFile(&lfs, dir, filepath));
-				}
-				free(dir);
+				return File(LittleFSFile::openDirectory(&lfs, filepath));
 			}
 		} else {
-			lfs_file_t *file = (lfs_file_t *)malloc(sizeof(lfs_file_t));
-			if (!file) return File();
-			if (lfs_file_open(&lfs, file, filepath, LFS_O_RDWR | LFS_O_CREAT) >= 0) {
-				//attributes get written when the file is closed
-				uint32_t filetime = 0;
-				uint32_t _now = Teensy3Clock.get();
-				rcode = lfs_getattr(&lfs, filepath, 'c', (void *)&filetime, sizeof(filetime));
-				if(rcode != sizeof(filetime)) {
-					rcode = lfs_setattr(&lfs, filepath, 'c', (const void *) &_now, sizeof(_now));
-					if(rcode < 0)
-						Serial.println("FO:: set attribute creation failed");
-				}
-				rcode = lfs_setattr(&lfs, filepath, 'm', (const void *) &_now, sizeof(_now));
-				if(rcode < 0)
-					Serial.println("FO:: set attribute modified failed");
-				if (mode == FILE_WRITE) {
-					lfs_file_seek(&lfs, file, 0, LFS_SEEK_END);
-				} // else FILE_WRITE_BEGIN
-				return File(new LittleFSFile(&lfs, file, filepath));
-			}
+			LittleFSFile *f = LittleFSFile::openFile(&lfs, filepath,
+				LFS_O_RDWR | LFS_O_CREAT);
+			if (f && mode == FILE_WRITE) {
+				lfs_file_seek(&lfs, f->file, 0, LFS_SEEK_END);
+			} // else FILE_WRITE_BEGIN
+			return File(f);
 		}
-		return File();
+	}
+	// Open a directory for listing with LittleFSDir::read()
+	bool openDir(LittleFSDir &d, const char *dirpath) {
+		d.close();
+		if (!mounted) return false;
+		if (lfs_dir_open(&lfs, &d.dir, dirpath) < 0) return false;
+		d.lfs = &lfs;
+		return true;
+	}
+	// Open a file for reading, with its list of blocks read into RAM so
+	// seeking anywhere in a large file is fast.  See buildIndex() above.
+	File openIndexed(const char *filepath, uint32_t entries=0) {
+		if (!mounted) return File();
+		LittleFSFile *f = LittleFSFile::openFile(&lfs, filepath, LFS_O_RDONLY);
+		if (f) f->buildIndex(entries);
+		return File(f);
 	}
 	bool exists(const char *filepath) {
 		if (!mounted) return false;
@@ -337,21 +580,115 @@ public:
 	}
 	uint64_t usedSize() {
 		if (!mounted) return 0;
+#if LITTLEFS_STATS
+		// counting used blocks reads the whole filesystem, so the result
+		// is kept until the media is next programmed or erased
+		if (used_valid) return used_size;
+#endif
+		return recomputeUsedSize();
+	}
+	uint64_t recomputeUsedSize() {
+		if (!mounted) return 0;
 		int blocks = lfs_fs_size(&lfs);
 		if (blocks < 0 || (lfs_size_t)blocks > config.block_count) return totalSize();
-		return blocks * config.block_size;
+		used_size = (uint64_t)blocks * config.block_size;
+#if LITTLEFS_STATS
+		used_valid = true;
+#endif
+		return used_size;
 	}
 	uint64_t totalSize() {
 		if (!mounted) return 0;
 		return config.block_count * config.block_size;
 	}
-	
+	const LittleFS_IOStats & getStats() { return stats; }
+	void resetStats() { memset(&stats, 0, sizeof(stats)); }
+	// How many open file objects, handles and caches are in use, the most
+	// ever in use, and how many didn't fit in the pools.  Shared by every
+	// LittleFS instance.
+	static const LittleFS_PoolStats & getPoolStats() { return LittleFSFile::pool_stats; }
+	// Trace into a ring buffer of count records.  When it fills, the oldest
+	// records are overwritten and counted by traceLost().
+	void beginTrace(LittleFS_TraceRecord *buffer, uint32_t count);
+	void endTrace() { tracing = false; }
+	// Remove up to count of the oldest records from the trace buffer
+	uint32_t readTrace(LittleFS_TraceRecord *buffer, uint32_t count);
+	uint32_t traceLost() { return trace_lost; }
 
 protected:
 	bool configured = false;
 	bool mounted = false;
 	lfs_t lfs = {};
+#if LITTLEFS_STATS
+	// littlefs only passes the config to the media functions, so the
+	// counting wrappers find everything they need through it.
+	struct lfs_config_stats : lfs_config {
+		LittleFS *fs;
+		int (*media_read)(const struct lfs_config *c, lfs_block_t block,
+			lfs_off_t off, void *buffer, lfs_size_t size);
+		int (*media_prog)(const struct lfs_config *c, lfs_block_t block,
+			lfs_off_t off, const void *buffer, lfs_size_t size);
+		int (*media_erase)(const struct lfs_config *c, lfs_block_t block);
+		int (*media_sync)(const struct lfs_config *c);
+	};
+	lfs_config_stats config = {};
+	void attachStats();
+#else
 	lfs_config config = {};
+	void attachStats() { erased_blocks = 0; }
+#endif
+	LittleFS_IOStats stats = {};
+	// Blocks known to be erased, one bit per block.  A bit is set when the
+	// block is erased or reads back blank, and cleared when it's programmed.
+	// Media erase() calls blockErased() to skip erasing blank blocks, which
+	// only reads the block back when its state is unknown.
+	bool blockErased(lfs_block_t block);
+	// For calibrateClock(), the fastest clock up to maxclock which reads
+	// back a test pattern, after setclock() changes the media's read clock
+	uint32_t findClock(uint32_t maxclock, void (*setclock)(const struct lfs_config *c, uint32_t hz));
+	// Maximum time the media takes to erase a block, set by begin(), which
+	// idleErase() assumes until it has timed an erase
+	uint32_t erase_time_us = 0;
+	bool erasedKnown(lfs_block_t block) {
+		return erased_map && block < erased_blocks
+			&& (erased_map[block / 8] & (1 << (block % 8)));
+	}
+	void setErased(lfs_block_t block) {
+		if (erased_map && block < erased_blocks) erased_map[block / 8] |= 1 << (block % 8);
+	}
+	void clearErased(lfs_block_t block) {
+		if (erased_map && block < erased_blocks) erased_map[block / 8] &= ~(1 << (block % 8));
+	}
+private:
+	uint64_t used_size = 0;
+	bool used_valid = false;
+	bool remount();
+	bool readCache(uint32_t lines, void *buffer);
+	bool allocBitmap(void *buffer, uint32_t size);
+	uint8_t *idle_used = nullptr;   // used blocks bitmap, then a read buffer
+	bool idle_dirty = false;        // blocks programmed since the traverse
+	uint32_t idle_next = 0;         // next block idleErase() checks
+	uint32_t idle_alloc = 0;        // allocator position at the last call
+	uint32_t idle_left = 0;         // blocks to check before traversing again
+	uint8_t *erased_map = nullptr;
+	uint32_t erased_blocks = 0;     // size of erased_map, 0 after begin()
+	lfs_block_t erase_checked = (lfs_block_t)-1; // not blank, blockErased() needn't read it
+	LittleFS_TraceRecord *trace_buf = nullptr;
+	uint32_t trace_size = 0;
+	uint32_t trace_head = 0;
+	uint32_t trace_tail = 0;
+	uint32_t trace_lost = 0;
+	bool tracing = false;
+#if LITTLEFS_STATS
+	void record_io(uint8_t op, LittleFS_IOCounter &counter, lfs_block_t block,
+	  lfs_off_t offset, lfs_size_t size, uint32_t begin_us, int err);
+	static int stats_read(const struct lfs_config *c, lfs_block_t block,
+	  lfs_off_t offset, void *buffer, lfs_size_t size);
+	static int stats_prog(const struct lfs_config *c, lfs_block_t block,
+	  lfs_off_t offset, const void *buffer, lfs_size_t size);
+	static int stats_erase(const struct lfs_config *c, lfs_block_t block);
+	static int stats_sync(const struct lfs_config *c);
+#endif
 };
 
 
@@ -382,6 +719,7 @@ public:
 		config.prog = &static_prog;
 		config.erase = &static_erase;
 		config.sync = &static_sync;
+		attachStats();
 		if ( size > 1024*1024 ) {
 			config.read_size = 256; // Must set cache_size. If read_buffer or prog_buffer are provided manually, these must be cache_size.
 			config.prog_size = 256;
@@ -415,6 +753,9 @@ public:
 	uint32_t formatUnused(uint32_t blockCnt, uint32_t blockStart) {
 		return 0;
 	}
+	uint32_t idleErase(uint32_t budget_us) {
+		return 0;
+	}
 	FLASHMEM
 	const char * getMediaName();
 	const char * name() { return getMediaName(); }
@@ -449,14 +790,39 @@ class LittleFS_SPIFlash : public LittleFS
 {
 public:
 	constexpr LittleFS_SPIFlash() { }
-	bool begin(uint8_t cspin, SPIClass &spiport=SPI);
+	// cacheSize may be a multiple of the chip's page size, for fewer and
+	// longer SPI transfers at the cost of RAM for each open file.
+	// blockSize 4096 uses 4K sector erases on chips with larger blocks, 0
+	// uses the chip's usual erase size.  Changing it reformats the chip.
+	// spiClock runs every command at up to that SCK, 0 for 30 MHz.
+	bool begin(uint8_t cspin, SPIClass &spiport=SPI, uint32_t cacheSize=0,
+	  uint32_t blockSize=0, uint32_t spiClock=0);
 	const char * getMediaName();
 	const char * name() { return getMediaName(); }
+	// When enabled, programs and erases return as soon as the command is
+	// sent, and the wait for the chip to finish is done at the start of
+	// the next operation or sync.  littlefs and the program run while the
+	// chip is busy.  Timeouts are returned by the operation which waits.
+	// On Winbond and GigaDevice chips, reads suspend an unfinished erase
+	// instead of waiting for it.
+	void setDeferredWait(bool enable) {
+		if (!enable) finish();
+		defer_wait = enable;
+	}
+	// Find the fastest SCK, up to maxClock or the chip's maximum, which
+	// reads back a test pattern written to an unused block, and use it for
+	// reads.  Other commands stay at begin()'s clock.  Returns the clock, or
+	// 0 if it failed and the clock is unchanged.  Call after begin().
+	uint32_t calibrateClock(uint32_t maxClock=0);
 private:
 	int read(lfs_block_t block, lfs_off_t offset, void *buf, lfs_size_t size);
 	int prog(lfs_block_t block, lfs_off_t offset, const void *buf, lfs_size_t size);
 	int erase(lfs_block_t block);
-	int wait(uint32_t microseconds);
+	int wait(uint32_t microseconds, uint32_t begin_us, uint32_t &typical_us);
+	int finish();
+	bool suspend(lfs_block_t block);
+	void resume();
+	bool isSuspended();
 	static int static_read(const struct lfs_config *c, lfs_block_t block,
 	  lfs_off_t offset, void *buffer, lfs_size_t size) {
 		//Serial.printf("  flash rd: block=%d, offset=%d, size=%d\n", block, offset, size);
@@ -472,11 +838,34 @@ private:
 		return ((LittleFS_SPIFlash *)(c->context))->erase(block);
 	}
 	static int static_sync(const struct lfs_config *c) {
-		return 0;
+		return ((LittleFS_SPIFlash *)(c->context))->finish();
+	}
+	void readSFDP(uint32_t addr, void *buf, uint32_t len);
+	static void static_sfdp(void *ctx, uint32_t addr, void *buf, uint32_t len) {
+		((LittleFS_SPIFlash *)ctx)->readSFDP(addr, buf, len);
+	}
+	static void static_clock(const struct lfs_config *c, uint32_t hz) {
+		((LittleFS_SPIFlash *)(c->context))->readclock = hz;
 	}
 	SPIClass *port = nullptr;
 	uint8_t pin = 0;
 	const void *hwinfo = nullptr;
+	void *sfdp_info = nullptr;      // chip description read from SFDP
+	uint8_t erasecmd = 0;           // for the block size begin() chose
+	uint32_t erasetime = 0;
+	uint32_t spiclock = 0;          // SCK for commands other than reads
+	uint8_t readcmd = 0;            // fast or plain read, for the chip
+	uint32_t readclock = 0;         // SCK for readcmd
+	bool defer_wait = false;
+	uint32_t busy_us = 0;           // timeout of the unfinished operation, 0 if none
+	bool busy_erase = false;        // the unfinished operation is an erase
+	lfs_block_t busy_block = 0;
+	uint32_t busy_begin = 0;        // micros() it started, plus any time suspended
+	uint32_t resume_begin = 0;      // micros() the erase last started or resumed
+	uint32_t suspend_begin = 0;     // micros() the erase was last suspended
+	bool can_suspend = false;
+	uint32_t prog_us = 0;           // typical page program time, 0 until measured
+	uint32_t erase_us = 0;          // typical erase time
 };
 
 
@@ -485,9 +874,12 @@ class LittleFS_SPIFram : public LittleFS
 {
 public:
 	constexpr LittleFS_SPIFram() { }
-	bool begin(uint8_t cspin, SPIClass &spiport=SPI);
+	// spiClock runs every command at up to that SCK, 0 for 30 MHz
+	bool begin(uint8_t cspin, SPIClass &spiport=SPI, uint32_t spiClock=0);
 	const char * getMediaName();
 	const char * name() { return getMediaName(); }
+	// The same as LittleFS_SPIFlash
+	uint32_t calibrateClock(uint32_t maxClock=0);
 private:
 	int read(lfs_block_t block, lfs_off_t offset, void *buf, lfs_size_t size);
 	int prog(lfs_block_t block, lfs_off_t offset, const void *buf, lfs_size_t size);
@@ -510,9 +902,14 @@ private:
 	static int static_sync(const struct lfs_config *c) {
 		return 0;
 	}
+	static void static_clock(const struct lfs_config *c, uint32_t hz) {
+		((LittleFS_SPIFram *)(c->context))->readclock = hz;
+	}
 	SPIClass *port = nullptr;
 	uint8_t pin = 0;
 	const void *hwinfo = nullptr;
+	uint32_t spiclock = 0;
+	uint32_t readclock = 0;         // SCK for read data, which calibrateClock() raises
 };
 
 
@@ -521,14 +918,15 @@ class LittleFS_QSPIFlash : public LittleFS
 {
 public:
 	constexpr LittleFS_QSPIFlash() { }
-	bool begin();
+	// cacheSize and blockSize are the same as LittleFS_SPIFlash
+	bool begin(uint32_t cacheSize=0, uint32_t blockSize=0);
 	const char * getMediaName();
 	const char * name() { return getMediaName(); }
 private:
 	int read(lfs_block_t block, lfs_off_t offset, void *buf, lfs_size_t size);
 	int prog(lfs_block_t block, lfs_off_t offset, const void *buf, lfs_size_t size);
 	int erase(lfs_block_t block);
-	int wait(uint32_t microseconds);
+	int wait(uint32_t microseconds, uint32_t begin_us, uint32_t &typical_us);
 	static int static_read(const struct lfs_config *c, lfs_block_t block,
 	  lfs_off_t offset, void *buffer, lfs_size_t size) {
 		//Serial.printf("   qspi rd: block=%d, offset=%d, size=%d\n", block, offset, size);
@@ -546,14 +944,23 @@ private:
 	static int static_sync(const struct lfs_config *c) {
 		return 0;
 	}
+	void readSFDP(uint32_t addr, void *buf, uint32_t len);
+	static void static_sfdp(void *ctx, uint32_t addr, void *buf, uint32_t len) {
+		((LittleFS_QSPIFlash *)ctx)->readSFDP(addr, buf, len);
+	}
 	const void *hwinfo = nullptr;
+	void *sfdp_info = nullptr;      // chip description read from SFDP
+	uint8_t erasecmd = 0;           // for the block size begin() chose
+	uint32_t erasetime = 0;
+	uint32_t prog_us = 0;           // typical page program time, 0 until measured
+	uint32_t erase_us = 0;          // typical erase time
 };
 #else
 class LittleFS_QSPIFlash : public LittleFS
 {
 public:
 	constexpr LittleFS_QSPIFlash() { }
-	bool begin() { return false; }
+	bool begin(uint32_t cacheSize=0, uint32_t blockSize=0) { return false; }
 };
 #endif
 
@@ -592,13 +999,16 @@ class LittleFS_SPINAND : public LittleFS
 {
 public:
 	constexpr LittleFS_SPINAND() { }
-	bool begin(uint8_t cspin, SPIClass &spiport=SPI);
+	// spiClock runs every command at up to that SCK, 0 for 30 MHz
+	bool begin(uint8_t cspin, SPIClass &spiport=SPI, uint32_t spiClock=0);
 	uint8_t readECC(uint32_t address, uint8_t *data, int length);
 	void readBBLUT(uint16_t *LBA, uint16_t *PBA, uint8_t *linkStatus);
 	bool lowLevelFormat(char progressChar, Print* pr=&Serial);
 	uint8_t addBBLUT(uint32_t block_address);  //temporary for testing
 	const char * getMediaName();
 	const char * name() { return getMediaName(); }
+	// The same as LittleFS_SPIFlash
+	uint32_t calibrateClock(uint32_t maxClock=0);
 private:
 	int read(lfs_block_t block, lfs_off_t offset, void *buf, lfs_size_t size);
 	int prog(lfs_block_t block, lfs_off_t offset, const void *buf, lfs_size_t size);
@@ -621,6 +1031,9 @@ private:
 	static int static_sync(const struct lfs_config *c) {
 		return 0;
 	}
+	static void static_clock(const struct lfs_config *c, uint32_t hz) {
+		((LittleFS_SPINAND *)(c->context))->readclock = hz;
+	}
   bool isReady();
   bool writeEnable();
   void eraseSector(uint32_t address);
@@ -633,6 +1046,8 @@ private:
 	SPIClass *port = nullptr;
 	uint8_t pin = 0;
 	const void *hwinfo = nullptr;
+	uint32_t spiclock = 0;
+	uint32_t readclock = 0;         // SCK for read data, which calibrateClock() raises
 	
 private:
   uint8_t die = 0;      //die = 0: use first 1GB die PA[16], die = 1: use second 1GB die PA[16].
@@ -62,7 +62,8 @@
 
 
 
-#define SPICONFIG_NAND   SPISettings(30000000, MSBFIRST, SPI_MODE0)
+#define SPICLOCK_NAND    30000000	// SCK unless begin() or calibrateClock() chooses another
+#define SPICONFIG_NAND(clock)   SPISettings(clock, MSBFIRST, SPI_MODE0)
 
 
 PROGMEM static const struct nand_chipinfo {
@@ -74,15 +75,16 @@ PROGMEM static const struct nand_chipinfo {
 	uint32_t progtime;	// maximum microseconds to wait for page programming
 	uint32_t erasetime;	// maximum microseconds to wait for sector erase
 	const char pn[22];		//flash name
+	uint8_t maxmhz;		// maximum SCK in MHz
 } known_chips[] = {
 	//NAND
 	//{{0xEF, 0xAA, 0x21}, 2048, 131072, 134217728,   2000, 15000},  //Winbond W25N01G
 	//Upper 24 blocks * 128KB/block will be used for bad block replacement area
 	//so reducing total chip size: 134217728 - 24*131072
-	{{0xEF, 0xAA, 0x21}, 2048, 131072, 0, 131596288, 2000, 15000, "W25N01GVZEIG"},  //Winbond W25N01G
+	{{0xEF, 0xAA, 0x21}, 2048, 131072, 0, 131596288, 2000, 15000, "W25N01GVZEIG", 104},  //Winbond W25N01G
 	//{{0xEF, 0xAA, 0x22}, 2048, 131072, 134217728*2, 2000, 15000},  //Winbond W25N02G
-	{{0xEF, 0xAA, 0x22}, 2048, 131072, 0, 265289728, 2000, 15000, "W25N02KVZEIR"},  //Winbond W25N02G
-	{{0xEF, 0xBB, 0x21}, 2048, 131072, 0, 265289728, 2000, 15000, "W25M02"},  //Winbond W25M02
+	{{0xEF, 0xAA, 0x22}, 2048, 131072, 0, 265289728, 2000, 15000, "W25N02KVZEIR", 104},  //Winbond W25N02G
+	{{0xEF, 0xBB, 0x21}, 2048, 131072, 0, 265289728, 2000, 15000, "W25M02", 104},  //Winbond W25M02
 };
 
 volatile uint32_t currentPage     = UINT32_MAX;
@@ -103,10 +105,11 @@ static const struct nand_chipinfo * chip_lookup(const uint8_t *id)
 
 
 FLASHMEM
-bool LittleFS_SPINAND::begin(uint8_t cspin, SPIClass &spiport)
+bool LittleFS_SPINAND::begin(uint8_t cspin, SPIClass &spiport, uint32_t spiClock)
 {
 	pin = cspin;
 	port = &spiport;
+	spiclock = (spiClock && spiClock < SPICLOCK_NAND) ? spiClock : SPICLOCK_NAND;
 
 	//Serial.println("flash begin");
 	configured = false;
@@ -115,7 +118,7 @@ bool LittleFS_SPINAND::begin(uint8_t cspin, SPIClass &spiport)
 	port->begin();
 
 	uint8_t buf[5] = {0x9F, 0, 0, 0, 0};
-	port->beginTransaction(SPICONFIG_NAND);
+	port->beginTransaction(SPICONFIG_NAND(spiclock));
 	digitalWrite(pin, LOW);
 	port->transfer(buf, 5);
 	digitalWrite(pin, HIGH);
@@ -125,6 +128,8 @@ bool LittleFS_SPINAND::begin(uint8_t cspin, SPIClass &spiport)
 	const struct nand_chipinfo *info = chip_lookup(buf+2);
 	if (!info) return false;
 	hwinfo = (const void *)info;
+	if (spiClock) spiclock = (spiClock < info->maxmhz * 1000000) ? spiClock : info->maxmhz * 1000000;
+	readclock = spiclock;
 	//Serial.printf("Flash size is %.2f Mbyte\n", (float)info->chipsize / 1048576.0f);
 	
 	//capacityID = buf[3];   //W25N01G has 1 die, W25N02G had 2 dies
@@ -146,14 +151,26 @@ bool LittleFS_SPINAND::begin(uint8_t cspin, SPIClass &spiport)
 	}
 
 		
-	//uint8_t status;
-	// No protection, WP-E off, WP-E prevents use of IO2.  PROT_REG(0xAO), PROT_CLEAR(0)
-	writeStatusRegister(0xA0, 0);
-	readStatusRegister(0xA0, false);
+	// Each die of the W25M02 has its own status registers, die 0 is left selected
+	for (uint8_t d = (deviceID == W25M02) ? 2 : 1; d-- > 0; ) {
+		if (deviceID == W25M02) {
+			port->beginTransaction(SPICONFIG_NAND(spiclock));
+			digitalWrite(pin, LOW);
+			port->transfer(0xC2);   //die select
+			port->transfer(d);
+			digitalWrite(pin, HIGH);
+			port->endTransaction();
+		}
 
-	// Buffered read mode (BUF = 1), ECC enabled (ECC = 1), 0xB0(0xB0), ECC_ENABLE((1 << 4)), ReadMode((1 << 3))
-	writeStatusRegister(0xB0, (1 << 4) | (1 << 3));
-	readStatusRegister(0xB0, false);
+		//uint8_t status;
+		// No protection, WP-E off, WP-E prevents use of IO2.  PROT_REG(0xAO), PROT_CLEAR(0)
+		writeStatusRegister(0xA0, 0);
+		readStatusRegister(0xA0, false);
+
+		// Buffered read mode (BUF = 1), ECC enabled (ECC = 1), 0xB0(0xB0), ECC_ENABLE((1 << 4)), ReadMode((1 << 3))
+		writeStatusRegister(0xB0, (1 << 4) | (1 << 3));
+		readStatusRegister(0xB0, false);
+	}
 
 	memset(&lfs, 0, sizeof(lfs));
 	memset(&config, 0, sizeof(config));
@@ -162,6 +179,8 @@ bool LittleFS_SPINAND::begin(uint8_t cspin, SPIClass &spiport)
 	config.prog = &static_prog;
 	config.erase = &static_erase;
 	config.sync = &static_sync;
+	erase_time_us = info->erasetime;
+	attachStats();
 	config.read_size = info->progsize;
 	config.prog_size = info->progsize;
 	config.block_size = info->erasesize;
@@ -202,24 +221,6 @@ static void printtbuf(const void *buf, unsigned int len)
 	//Serial.println();
 }
 
-static bool blockIsBlank(struct lfs_config *config, lfs_block_t block, void *readBuf, bool full=true );
-static bool blockIsBlank(struct lfs_config *config, lfs_block_t block, void *readBuf, bool full)
-{
-	if (!readBuf) return false;
-	for (lfs_off_t offset=0; offset < config->block_size; offset += config->read_size) {
-		memset(readBuf, 0, config->read_size);
-		config->read(config, block, offset, readBuf, config->read_size);
-		const uint8_t *buf = (uint8_t *)readBuf;
-		//printtbuf(buf, 20);
-		for (unsigned int i=0; i < config->read_size; i++) {
-			if (buf[i] != 0xFF) return false;
-		}
-		if ( !full )
-			return true; // first bytes read as 0xFF
-	}
-	return true; // all bytes read as 0xFF
-}
-
 int LittleFS_SPINAND::read(lfs_block_t block, lfs_off_t offset, void *buf, lfs_size_t size)
 {
 	if (!port) return LFS_ERR_IO;
@@ -245,7 +246,7 @@ int LittleFS_SPINAND::read(lfs_block_t block, lfs_off_t offset, void *buf, lfs_s
 	cmd[2] = column;
 	cmd[3] = 0;
 
-	port->beginTransaction(SPICONFIG_NAND);
+	port->beginTransaction(SPICONFIG_NAND(readclock));
 	digitalWrite(pin, LOW);
 	port->transfer(cmd, 4);
 	port->transfer(buf, size);
@@ -280,6 +281,7 @@ int LittleFS_SPINAND::read(lfs_block_t block, lfs_off_t offset, void *buf, lfs_s
 int LittleFS_SPINAND::prog(lfs_block_t block, lfs_off_t offset, const void *buf, lfs_size_t size)
 {
 	if (!port) return LFS_ERR_IO;
+	clearErased(block);
 	
 	uint8_t cmd1[4], die_select;
 
@@ -304,7 +306,7 @@ int LittleFS_SPINAND::prog(lfs_block_t block, lfs_off_t offset, const void *buf,
 	
 	if(deviceID == W25M02) {
 		//issue Select Die command before issuing a page load
-		port->beginTransaction(SPICONFIG_NAND);
+		port->beginTransaction(SPICONFIG_NAND(spiclock));
 		digitalWrite(pin, LOW);
 		port -> transfer(0xC2);
 		port -> transfer(die_select);
@@ -324,10 +326,10 @@ int LittleFS_SPINAND::prog(lfs_block_t block, lfs_off_t offset, const void *buf,
 	cmd[1] = columnAddress >> 8; 
 	cmd[2] = columnAddress;
 
-	port->beginTransaction(SPICONFIG_NAND);
+	port->beginTransaction(SPICONFIG_NAND(spiclock));
 	digitalWrite(pin, LOW);
 	port->transfer(cmd, 3);
-	port->transfer(buf, nullptr, size); 
+	port->transfer(buf, nullptr, size);
 	digitalWrite(pin, HIGH);
 	port->endTransaction();
 
@@ -342,7 +344,7 @@ int LittleFS_SPINAND::prog(lfs_block_t block, lfs_off_t offset, const void *buf,
 	//cmd1[1] defined above
 	cmd1[2] = pageAddress >> 8; 
 	cmd1[3] = pageAddress;
-	port->beginTransaction(SPICONFIG_NAND);
+	port->beginTransaction(SPICONFIG_NAND(spiclock));
 	digitalWrite(pin, LOW);
 	port->transfer(cmd1, 4);
 	digitalWrite(pin, HIGH);
@@ -357,24 +359,19 @@ int LittleFS_SPINAND::erase(lfs_block_t block)
 	
 	const uint32_t addr = block * config.block_size;
 	
-	void *buffer = malloc(config.read_size);
-	if ( buffer != nullptr) {
-		if ( blockIsBlank(&config, block, buffer)) {
-			free(buffer);
-			return 0; // Already formatted exit no wait
-		}
-		free(buffer);
-	}
+	if (blockErased(block)) return 0; // Already formatted exit no wait
 
 	eraseSector(addr);
 	const uint32_t erasetime = ((const struct nand_chipinfo *)hwinfo)->erasetime;
-	return 	wait(erasetime);
+	int err = wait(erasetime);
+	if (!err) setErased(block);
+	return err;
 }
  
 bool LittleFS_SPINAND::isReady()
 {
 	uint8_t val;
-	port->beginTransaction(SPICONFIG_NAND);
+	port->beginTransaction(SPICONFIG_NAND(spiclock));
 	digitalWrite(pin, LOW);
 	port->transfer(0x05);  //0x05 - read status register
 	port->transfer(0xC0);
@@ -400,7 +397,7 @@ int LittleFS_SPINAND::wait(uint32_t microseconds)
 bool LittleFS_SPINAND::writeEnable()
 {
 	uint8_t status;
-	port->beginTransaction(SPICONFIG_NAND);
+	port->beginTransaction(SPICONFIG_NAND(spiclock));
 	digitalWrite(pin, LOW);
 	port->transfer(0x06);  //Write Enable 0x06
 	digitalWrite(pin, HIGH);
@@ -436,7 +433,7 @@ void LittleFS_SPINAND::eraseSector(uint32_t address)
 
 	if(deviceID == W25M02) {
 		//setup new LUT to issue Select Die command before issuing a page load
-		port->beginTransaction(SPICONFIG_NAND);
+		port->beginTransaction(SPICONFIG_NAND(spiclock));
 		digitalWrite(pin, LOW);
 		port -> transfer(0xC2);   //die select
 		port -> transfer(die_select);
@@ -455,7 +452,7 @@ void LittleFS_SPINAND::eraseSector(uint32_t address)
 
 	writeEnable();
 	
-	port->beginTransaction(SPICONFIG_NAND);
+	port->beginTransaction(SPICONFIG_NAND(spiclock));
 	digitalWrite(pin, LOW);
 	port->transfer(cmd, 4);
 	digitalWrite(pin, HIGH);
@@ -469,7 +466,7 @@ void LittleFS_SPINAND::eraseSector(uint32_t address)
 
 void LittleFS_SPINAND::writeStatusRegister(uint8_t reg, uint8_t data)
 {
-	port->beginTransaction(SPICONFIG_NAND);
+	port->beginTransaction(SPICONFIG_NAND(spiclock));
 	digitalWrite(pin, LOW);
 	port->transfer(0x01);  //0x01 - write status register
 	port->transfer(reg);
@@ -482,7 +479,7 @@ void LittleFS_SPINAND::writeStatusRegister(uint8_t reg, uint8_t data)
 uint8_t LittleFS_SPINAND::readStatusRegister(uint16_t reg, bool dump)
 {
 	uint8_t val;
-	port->beginTransaction(SPICONFIG_NAND);
+	port->beginTransaction(SPICONFIG_NAND(spiclock));
 	digitalWrite(pin, LOW);
 	port->transfer(0x05);  //0x05 - read status register
 	port->transfer(reg);
@@ -519,7 +516,7 @@ void LittleFS_SPINAND::loadPage(uint32_t address)
 
 	if(deviceID == W25M02) {
 		//setup new LUT to issue Select Die command before issuing a page load
-		port->beginTransaction(SPICONFIG_NAND);
+		port->beginTransaction(SPICONFIG_NAND(spiclock));
 		digitalWrite(pin, LOW);
 		port -> transfer(0xC2);
 		port -> transfer(die_select);
@@ -537,7 +534,7 @@ void LittleFS_SPINAND::loadPage(uint32_t address)
 	cmd[2] = targetPage >> 8; 
 	cmd[3] = targetPage;
 
- 	port->beginTransaction(SPICONFIG_NAND);
+ 	port->beginTransaction(SPICONFIG_NAND(spiclock));
 	digitalWrite(pin, LOW);
 	port->transfer(cmd, 4);
 	digitalWrite(pin, HIGH);
@@ -562,7 +559,7 @@ uint8_t LittleFS_SPINAND::readECC(uint32_t targetPage, uint8_t *data, int length
 
 	if(deviceID == W25M02) {
 		//setup new LUT to issue Select Die command before issuing a page load
-		port->beginTransaction(SPICONFIG_NAND);
+		port->beginTransaction(SPICONFIG_NAND(spiclock));
 		digitalWrite(pin, LOW);
 		port -> transfer(0xC2);
 		port -> transfer(die_select);
@@ -578,7 +575,7 @@ uint8_t LittleFS_SPINAND::readECC(uint32_t targetPage, uint8_t *data, int length
 	cmd[2] = targetPage >> 8; 
 	cmd[3] = targetPage;
 
- 	port->beginTransaction(SPICONFIG_NAND);
+ 	port->beginTransaction(SPICONFIG_NAND(spiclock));
 	digitalWrite(pin, LOW);
 	port->transfer(cmd, 4);
 	digitalWrite(pin, HIGH);
@@ -593,7 +590,7 @@ uint8_t LittleFS_SPINAND::readECC(uint32_t targetPage, uint8_t *data, int length
 	cmd1[2] = column >> 8;
 	cmd1[3] = column;
 
-	port->beginTransaction(SPICONFIG_NAND);
+	port->beginTransaction(SPICONFIG_NAND(readclock));
 	digitalWrite(pin, LOW);
 	port->transfer(cmd1, 4);
 	port->transfer(data, length);
@@ -633,7 +630,7 @@ void LittleFS_SPINAND::readBBLUT(uint16_t *LBA, uint16_t *PBA, uint8_t *linkStat
 	
 	uint8_t data[20 * 4];
 
-	port->beginTransaction(SPICONFIG_NAND);
+	port->beginTransaction(SPICONFIG_NAND(spiclock));
 	digitalWrite(pin, LOW);
 	port->transfer(0xA5);  //Read BBM_LUT 0xA5
 	port->transfer(0);
@@ -727,7 +724,7 @@ uint8_t LittleFS_SPINAND::addBBLUT(uint32_t block_address)
 	cmd[3] = lba >> 8;
 	cmd[4] = lba;
 	
-	//port->beginTransaction(SPICONFIG_NAND);
+	//port->beginTransaction(SPICONFIG_NAND(spiclock));
 	//digitalWrite(pin, LOW);
 	//port->transfer(cmd, 5);
 	//digitalWrite(pin, HIGH);
@@ -743,7 +740,7 @@ uint8_t LittleFS_SPINAND::addBBLUT(uint32_t block_address)
 void LittleFS_SPINAND::deviceReset()
 {
 
-	port->beginTransaction(SPICONFIG_NAND);
+	port->beginTransaction(SPICONFIG_NAND(spiclock));
 	digitalWrite(pin, LOW);
 	port->transfer(0xFF);
 	digitalWrite(pin, HIGH);
@@ -775,6 +772,17 @@ bool LittleFS_SPINAND::lowLevelFormat(char progressChar, Print* pr)
 }
 
 
+uint32_t LittleFS_SPINAND::calibrateClock(uint32_t maxClock)
+{
+	if (!hwinfo) return 0;
+	const uint32_t chipclock = ((const struct nand_chipinfo *)hwinfo)->maxmhz * 1000000;
+	if (!maxClock || maxClock > chipclock) maxClock = chipclock;
+	const uint32_t old_readclock = readclock;
+	const uint32_t clock = findClock(maxClock, &static_clock);
+	if (!clock) readclock = old_readclock;
+	return clock;
+}
+
 const char * LittleFS_SPINAND::getMediaName() {
 	if (!hwinfo) return nullptr; 
 	return ((const struct nand_chipinfo *)hwinfo)->pn;
@@ -971,6 +979,8 @@ bool LittleFS_QPINAND::begin() {
 	config.prog = &static_prog;
 	config.erase = &static_erase;
 	config.sync = &static_sync;
+	erase_time_us = info->erasetime;
+	attachStats();
 	config.read_size = info->progsize;
 	config.prog_size = info->progsize;
 	config.block_size = info->erasesize;
@@ -1112,6 +1122,7 @@ int LittleFS_QPINAND::read(lfs_block_t block, lfs_off_t offset, void *buf, lfs_s
 
 int LittleFS_QPINAND::prog(lfs_block_t block, lfs_off_t offset, const void *buf, lfs_size_t size)
 {
+	clearErased(block);
 	const uint32_t address = block * config.block_size + offset;
 	uint32_t newTargetPage;
 	uint8_t val;
@@ -1169,18 +1180,12 @@ int LittleFS_QPINAND::erase(lfs_block_t block)
 {	
 	const uint32_t addr = block * config.block_size;
 	
-	void *buffer = malloc(config.read_size);
-	if ( buffer != nullptr) {
-		if ( blockIsBlank(&config, block, buffer)) {
-			free(buffer);
-			return 0; // Already formatted exit no wait
-		}
-		free(buffer);
-	}
+	if (blockErased(block)) return 0; // Already formatted exit no wait
 	
 	eraseSector(addr);
 	const uint32_t erasetime = ((const struct nand_chipinfo *)hwinfo)->erasetime;
 	wait(erasetime);
+	setErased(block);
 	return 0;
 }
  
@@ -24,6 +24,67 @@ static inline void lfs_cache_zero(lfs_t *lfs, lfs_cache_t *pcache) {
     pcache->block = LFS_BLOCK_NULL;
 }
 
+// extra read cache lines, kept in order of use, most recent first
+static bool lfs_rlines_get(lfs_t *lfs, lfs_cache_t *rcache) {
+    for (lfs_size_t i = 0; i < lfs->cfg->read_cache_lines; i++) {
+        lfs_cache_t *line = &lfs->rlines[i];
+        if (line->block == rcache->block &&
+                line->off <= rcache->off &&
+                rcache->off + rcache->size <= line->off + line->size) {
+            memcpy(rcache->buffer, &line->buffer[rcache->off - line->off],
+                    rcache->size);
+
+            lfs_cache_t hit = *line;
+            memmove(&lfs->rlines[1], &lfs->rlines[0], i*sizeof(lfs_cache_t));
+            lfs->rlines[0] = hit;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void lfs_rlines_put(lfs_t *lfs, const lfs_cache_t *rcache) {
+    lfs_size_t n = lfs->cfg->read_cache_lines;
+    if (n == 0) {
+        return;
+    }
+
+    // replace the least recently used line
+    lfs_cache_t line = lfs->rlines[n-1];
+    memmove(&lfs->rlines[1], &lfs->rlines[0], (n-1)*sizeof(lfs_cache_t));
+    line.block = rcache->block;
+    line.off = rcache->off;
+    line.size = rcache->size;
+    memcpy(line.buffer, rcache->buffer, rcache->size);
+    lfs->rlines[0] = line;
+}
+
+#ifndef LFS_READONLY
+static void lfs_rlines_drop(lfs_t *lfs,
+        lfs_block_t block, lfs_off_t off, lfs_size_t size) {
+    for (lfs_size_t i = 0; i < lfs->cfg->read_cache_lines; i++) {
+        lfs_cache_t *line = &lfs->rlines[i];
+        if (line->block == block &&
+                off < line->off + line->size &&
+                line->off < off + size) {
+            line->block = LFS_BLOCK_NULL;
+        }
+    }
+}
+#endif
+
+// forget remembered metadata pairs which use this block
+static void lfs_mcache_drop(lfs_t *lfs, lfs_block_t block) {
+    for (lfs_size_t i = 0; i < lfs->cfg->mdir_cache_count; i++) {
+        lfs_mdir_t *m = &lfs->mcache[i];
+        if (m->pair[0] == block || m->pair[1] == block) {
+            m->pair[0] = LFS_BLOCK_NULL;
+            m->pair[1] = LFS_BLOCK_NULL;
+        }
+    }
+}
+
 static int lfs_bd_read(lfs_t *lfs,
         const lfs_cache_t *pcache, lfs_cache_t *rcache, lfs_size_t hint,
         lfs_block_t block, lfs_off_t off,
@@ -96,12 +157,18 @@ static int lfs_bd_read(lfs_t *lfs,
                     lfs->cfg->block_size)
                 - rcache->off,
                 lfs->cfg->cache_size);
+        if (lfs_rlines_get(lfs, rcache)) {
+            continue;
+        }
+
         int err = lfs->cfg->read(lfs->cfg, rcache->block,
                 rcache->off, rcache->buffer, rcache->size);
         LFS_ASSERT(err <= 0);
         if (err) {
             return err;
         }
+
+        lfs_rlines_put(lfs, rcache);
     }
 
     return 0;
@@ -146,6 +213,8 @@ static int lfs_bd_flush(lfs_t *lfs,
     if (pcache->block != LFS_BLOCK_NULL && pcache->block != LFS_BLOCK_INLINE) {
         LFS_ASSERT(pcache->block < lfs->cfg->block_count);
         lfs_size_t diff = lfs_alignup(pcache->size, lfs->cfg->prog_size);
+        lfs_rlines_drop(lfs, pcache->block, pcache->off, diff);
+        lfs_mcache_drop(lfs, pcache->block);
         int err = lfs->cfg->prog(lfs->cfg, pcache->block,
                 pcache->off, pcache->buffer, diff);
         LFS_ASSERT(err <= 0);
@@ -242,6 +311,8 @@ static int lfs_bd_prog(lfs_t *lfs,
 #ifndef LFS_READONLY
 static int lfs_bd_erase(lfs_t *lfs, lfs_block_t block) {
     LFS_ASSERT(block < lfs->cfg->block_count);
+    lfs_rlines_drop(lfs, block, 0, lfs->cfg->block_size);
+    lfs_mcache_drop(lfs, block);
     int err = lfs->cfg->erase(lfs->cfg, block);
     LFS_ASSERT(err <= 0);
     return err;
@@ -835,6 +906,32 @@ static int lfs_dir_traverse(lfs_t *lfs,
 }
 #endif
 
+// remembered metadata pairs, kept in order of use, most recent first
+static const lfs_mdir_t *lfs_mcache_get(lfs_t *lfs,
+        const lfs_block_t pair[2]) {
+    for (lfs_size_t i = 0; i < lfs->cfg->mdir_cache_count; i++) {
+        if (lfs_pair_sync(lfs->mcache[i].pair, pair)) {
+            lfs_mdir_t hit = lfs->mcache[i];
+            memmove(&lfs->mcache[1], &lfs->mcache[0], i*sizeof(lfs_mdir_t));
+            lfs->mcache[0] = hit;
+            return &lfs->mcache[0];
+        }
+    }
+
+    return NULL;
+}
+
+static void lfs_mcache_put(lfs_t *lfs, const lfs_mdir_t *dir) {
+    lfs_size_t n = lfs->cfg->mdir_cache_count;
+    if (n == 0) {
+        return;
+    }
+
+    // replace the least recently used pair
+    memmove(&lfs->mcache[1], &lfs->mcache[0], (n-1)*sizeof(lfs_mdir_t));
+    lfs->mcache[0] = *dir;
+}
+
 static lfs_stag_t lfs_dir_fetchmatch(lfs_t *lfs,
         lfs_mdir_t *dir, const lfs_block_t pair[2],
         lfs_tag_t fmask, lfs_tag_t ftag, uint16_t *id,
@@ -849,21 +946,35 @@ static lfs_stag_t lfs_dir_fetchmatch(lfs_t *lfs,
         return LFS_ERR_CORRUPT;
     }
 
+    // a remembered pair has not changed since it was last fetched, so
+    // its commits are known to be valid and need not be checksummed
+    const lfs_mdir_t *known = lfs_mcache_get(lfs, pair);
+    if (known && !cb) {
+        *dir = *known;
+        return 0;
+    }
+
     // find the block with the most recent revision
     uint32_t revs[2] = {0, 0};
     int r = 0;
-    for (int i = 0; i < 2; i++) {
-        int err = lfs_bd_read(lfs,
-                NULL, &lfs->rcache, sizeof(revs[i]),
-                pair[i], 0, &revs[i], sizeof(revs[i]));
-        revs[i] = lfs_fromle32(revs[i]);
-        if (err && err != LFS_ERR_CORRUPT) {
-            return err;
-        }
+    if (known) {
+        revs[0] = known->rev;
+        revs[1] = known->rev;
+        pair = known->pair;
+    } else {
+        for (int i = 0; i < 2; i++) {
+            int err = lfs_bd_read(lfs,
+                    NULL, &lfs->rcache, sizeof(revs[i]),
+                    pair[i], 0, &revs[i], sizeof(revs[i]));
+            revs[i] = lfs_fromle32(revs[i]);
+            if (err && err != LFS_ERR_CORRUPT) {
+                return err;
+            }
 
-        if (err != LFS_ERR_CORRUPT &&
-                lfs_scmp(revs[i], revs[(i+1)%2]) > 0) {
-            r = i;
+            if (err != LFS_ERR_CORRUPT &&
+                    lfs_scmp(revs[i], revs[(i+1)%2]) > 0) {
+                r = i;
+            }
         }
     }
 
@@ -917,7 +1028,22 @@ static lfs_stag_t lfs_dir_fetchmatch(lfs_t *lfs,
 
             ptag = tag;
 
-            if (lfs_tag_type1(tag) == LFS_TYPE_CRC) {
+            if (lfs_tag_type1(tag) == LFS_TYPE_CRC && known) {
+                // commit already checked when the pair was remembered
+                ptag ^= (lfs_tag_t)(lfs_tag_chunk(tag) & 1U) << 31;
+                besttag = tempbesttag;
+                dir->off = off + lfs_tag_dsize(tag);
+                dir->etag = ptag;
+                dir->count = tempcount;
+                dir->tail[0] = temptail[0];
+                dir->tail[1] = temptail[1];
+                dir->split = tempsplit;
+                if (dir->off >= known->off) {
+                    dir->erased = known->erased;
+                    break;
+                }
+                continue;
+            } else if (lfs_tag_type1(tag) == LFS_TYPE_CRC) {
                 // check the crc attr
                 uint32_t dcrc;
                 err = lfs_bd_read(lfs,
@@ -961,7 +1087,8 @@ static lfs_stag_t lfs_dir_fetchmatch(lfs_t *lfs,
             }
 
             // crc the entry first, hopefully leaving it in the cache
-            for (lfs_off_t j = sizeof(tag); j < lfs_tag_dsize(tag); j++) {
+            for (lfs_off_t j = sizeof(tag);
+                    !known && j < lfs_tag_dsize(tag); j++) {
                 uint8_t dat;
                 err = lfs_bd_read(lfs,
                         NULL, &lfs->rcache, lfs->cfg->block_size,
@@ -1038,6 +1165,10 @@ static lfs_stag_t lfs_dir_fetchmatch(lfs_t *lfs,
 
         // consider what we have good enough
         if (dir->off > 0) {
+            if (!known) {
+                lfs_mcache_put(lfs, dir);
+            }
+
             // synthetic move
             if (lfs_gstate_hasmovehere(&lfs->gdisk, dir->pair)) {
                 if (lfs_tag_id(lfs->gdisk.tag) == lfs_tag_id(besttag)) {
@@ -1063,6 +1194,13 @@ static lfs_stag_t lfs_dir_fetchmatch(lfs_t *lfs,
         }
 
         // failed, try the other block?
+        if (known) {
+            // changed without being programmed? fetch it the long way
+            const lfs_block_t retry[2] = {known->pair[0], known->pair[1]};
+            lfs_mcache_drop(lfs, retry[0]);
+            return lfs_dir_fetchmatch(lfs, dir, retry,
+                    fmask, ftag, id, cb, data);
+        }
         lfs_pair_swap(dir->pair);
         dir->rev = revs[(r+1)%2];
     }
@@ -1162,7 +1300,7 @@ static int lfs_dir_find_match(void *data,
     return LFS_CMP_EQ;
 }
 
-static lfs_stag_t lfs_dir_find(lfs_t *lfs, lfs_mdir_t *dir,
+static lfs_stag_t lfs_dir_findpath(lfs_t *lfs, lfs_mdir_t *dir,
         const char **path, uint16_t *id) {
     // we reduce path to a single name if we can find it
     const char *name = *path;
@@ -1262,6 +1400,108 @@ nextname:
     }
 }
 
+/// Path lookup cache ///
+// a found path, kept as its names separated by single slashes, and the
+// metadata pair and tag it was found at
+struct lfs_dentry {
+    lfs_block_t pair[2];
+    lfs_stag_t tag;
+    lfs_size_t len;
+    char path[LFS_DCACHE_PATH_MAX];
+};
+
+// reduce a path to its cache key, returns 0 if it can't be remembered,
+// otherwise the key length with last set to the path's last name
+static lfs_size_t lfs_dcache_key(const char *path, char *key,
+        const char **last) {
+    lfs_size_t len = 0;
+    while (true) {
+        lfs_size_t slashes = strspn(path, "/");
+        path += slashes;
+        lfs_size_t namelen = strcspn(path, "/");
+        if (namelen == 0) {
+            // a trailing slash is checked by lfs_dir_findpath
+            return (len && slashes) ? 0 : len;
+        }
+
+        // leave '.' and '..' to lfs_dir_findpath
+        if ((namelen == 1 && memcmp(path, ".", 1) == 0) ||
+            (namelen == 2 && memcmp(path, "..", 2) == 0)) {
+            return 0;
+        }
+
+        if (len + (len ? 1 : 0) + namelen > LFS_DCACHE_PATH_MAX) {
+            return 0;
+        }
+
+        if (len) {
+            key[len++] = '/';
+        }
+        memcpy(&key[len], path, namelen);
+        len += namelen;
+        *last = path;
+        path += namelen;
+    }
+}
+
+#ifndef LFS_READONLY
+// forget every path found in this metadata pair
+static void lfs_dcache_drop(lfs_t *lfs, const lfs_block_t pair[2]) {
+    for (lfs_size_t i = 0; i < lfs->cfg->dentry_cache_count; i++) {
+        if (lfs_pair_sync(lfs->dcache[i].pair, pair)) {
+            lfs->dcache[i].len = 0;
+        }
+    }
+}
+#endif
+
+// forget every path, needed when entries move between metadata pairs
+static void lfs_dcache_clear(lfs_t *lfs) {
+    for (lfs_size_t i = 0; i < lfs->cfg->dentry_cache_count; i++) {
+        lfs->dcache[i].len = 0;
+    }
+}
+
+static lfs_stag_t lfs_dir_find(lfs_t *lfs, lfs_mdir_t *dir,
+        const char **path, uint16_t *id) {
+    if (!lfs->cfg->dentry_cache_count) {
+        return lfs_dir_findpath(lfs, dir, path, id);
+    }
+
+    char key[LFS_DCACHE_PATH_MAX];
+    const char *last = NULL;
+    lfs_size_t len = lfs_dcache_key(*path, key, &last);
+    if (len == 0) {
+        return lfs_dir_findpath(lfs, dir, path, id);
+    }
+
+    struct lfs_dentry *d = &lfs->dcache[
+            lfs_crc(0xffffffff, key, len) % lfs->cfg->dentry_cache_count];
+    if (d->len == len && memcmp(d->path, key, len) == 0) {
+        int err = lfs_dir_fetch(lfs, dir, d->pair);
+        if (err) {
+            return err;
+        }
+
+        *path = last;
+        if (id) {
+            *id = lfs_tag_id(d->tag);
+        }
+        return d->tag;
+    }
+
+    lfs_stag_t tag = lfs_dir_findpath(lfs, dir, path, id);
+    if (tag >= 0 && lfs_tag_id(tag) != 0x3ff) {
+        d->pair[0] = dir->pair[0];
+        d->pair[1] = dir->pair[1];
+        d->tag = tag;
+        d->len = len;
+        memcpy(d->path, key, len);
+    }
+
+    return tag;
+}
+
 // commit logic
 struct lfs_commit {
     lfs_block_t block;
@@ -1485,6 +1725,8 @@ static int lfs_dir_alloc(lfs_t *lfs, lfs_mdir_t *dir) {
 
 #ifndef LFS_READONLY
 static int lfs_dir_drop(lfs_t *lfs, lfs_mdir_t *dir, lfs_mdir_t *tail) {
+    lfs_dcache_clear(lfs);
+
     // steal state
     int err = lfs_dir_getgstate(lfs, tail, &lfs->gdelta);
     if (err) {
@@ -1567,6 +1809,9 @@ static int lfs_dir_commit_commit(void *p, lfs_tag_t tag, const void *buffer) {
 static int lfs_dir_compact(lfs_t *lfs,
         lfs_mdir_t *dir, const struct lfs_mattr *attrs, int attrcount,
         lfs_mdir_t *source, uint16_t begin, uint16_t end) {
+    // entries may split off to a new pair or the pair may relocate
+    lfs_dcache_clear(lfs);
+
     // save some state in case block is bad
     const lfs_block_t oldpair[2] = {dir->pair[0], dir->pair[1]};
     bool relocated = false;
@@ -1825,6 +2070,9 @@ relocate:
 #ifndef LFS_READONLY
 static int lfs_dir_commit(lfs_t *lfs, lfs_mdir_t *dir,
         const struct lfs_mattr *attrs, int attrcount) {
+    // ids in this pair may change
+    lfs_dcache_drop(lfs, dir->pair);
+
     // check for any inline files that aren't RAM backed and
     // forcefully evict them, needed for filesystem consistency
     for (lfs_file_t *f = (lfs_file_t*)lfs->mlist; f; f = f->next) {
@@ -2208,6 +2456,28 @@ static int lfs_dir_rawread(lfs_t *lfs, lfs_dir_t *dir, struct lfs_info *info) {
     return true;
 }
 
+static lfs_ssize_t lfs_dir_rawgetattr(lfs_t *lfs, lfs_dir_t *dir,
+        uint8_t type, void *buffer, lfs_size_t size) {
+    // '.' and '..' have no attributes, the entry read last is id-1
+    if (dir->pos <= 2 || dir->id == 0) {
+        return LFS_ERR_NOATTR;
+    }
+
+    lfs_stag_t tag = lfs_dir_get(lfs, &dir->m, LFS_MKTAG(0x7ff, 0x3ff, 0),
+            LFS_MKTAG(LFS_TYPE_USERATTR + type,
+                dir->id-1, lfs_min(size, lfs->attr_max)),
+            buffer);
+    if (tag < 0) {
+        if (tag == LFS_ERR_NOENT) {
+            return LFS_ERR_NOATTR;
+        }
+
+        return tag;
+    }
+
+    return lfs_tag_size(tag);
+}
+
 static int lfs_dir_rawseek(lfs_t *lfs, lfs_dir_t *dir, lfs_off_t off) {
     // simply walk from head dir
     int err = lfs_dir_rawrewind(lfs, dir);
@@ -2277,10 +2547,26 @@ static int lfs_ctz_index(lfs_t *lfs, lfs_off_t *off) {
     return i;
 }
 
+// forget the remembered blocks, and space the positions so the buffer
+// covers a file ending at block index last
+static void lfs_ctz_resetindex(struct lfs_ctzindex *index,
+        lfs_block_t head, lfs_off_t last) {
+    index->stride = 1;
+    while (last / index->stride >= index->size) {
+        index->stride *= 2;
+    }
+
+    for (lfs_size_t i = 0; i < index->size; i++) {
+        index->buffer[i] = LFS_BLOCK_NULL;
+    }
+    index->head = head;
+}
+
 static int lfs_ctz_find(lfs_t *lfs,
         const lfs_cache_t *pcache, lfs_cache_t *rcache,
         lfs_block_t head, lfs_size_t size,
-        lfs_size_t pos, lfs_block_t *block, lfs_off_t *off) {
+        lfs_size_t pos, lfs_block_t *block, lfs_off_t *off,
+        struct lfs_ctzindex *index) {
     if (size == 0) {
         *block = LFS_BLOCK_NULL;
         *off = 0;
@@ -2290,6 +2576,26 @@ static int lfs_ctz_find(lfs_t *lfs,
     lfs_off_t current = lfs_ctz_index(lfs, &(lfs_off_t){size-1});
     lfs_off_t target = lfs_ctz_index(lfs, &pos);
 
+    if (index && !index->buffer) {
+        index = NULL;
+    }
+
+    if (index) {
+        if (index->head != head) {
+            lfs_ctz_resetindex(index, head, current);
+        }
+
+        // start from the nearest remembered block after the target
+        for (lfs_off_t i = (target + index->stride-1) / index->stride;
+                i < index->size && i*index->stride < current; i++) {
+            if (index->buffer[i] != LFS_BLOCK_NULL) {
+                current = i*index->stride;
+                head = index->buffer[i];
+                break;
+            }
+        }
+    }
+
     while (current > target) {
         lfs_size_t skip = lfs_min(
                 lfs_npw2(current-target+1) - 1,
@@ -2304,6 +2610,12 @@ static int lfs_ctz_find(lfs_t *lfs,
         }
 
         current -= 1 << skip;
+
+        // remember blocks we pass at indexed positions
+        if (index && current % index->stride == 0 &&
+                current / index->stride < index->size) {
+            index->buffer[current / index->stride] = head;
+        }
     }
 
     *block = head;
@@ -2478,6 +2790,8 @@ static int lfs_file_rawopencfg(lfs_t *lfs, lfs_file_t *file,
     file->pos = 0;
     file->off = 0;
     file->cache.buffer = NULL;
+    file->index.buffer = NULL;
+    file->index.size = 0;
 
     // allocate entry for file if it doesn't exist
     lfs_stag_t tag = lfs_dir_find(lfs, &file->m, &path, &file->id);
@@ -2800,6 +3114,7 @@ relocate:
         // actual file updates
         file->ctz.head = file->block;
         file->ctz.size = file->pos;
+        file->index.head = LFS_BLOCK_NULL;
         file->flags &= ~LFS_F_WRITING;
         file->flags |= LFS_F_DIRTY;
 
@@ -2895,7 +3210,7 @@ static lfs_ssize_t lfs_file_rawread(lfs_t *lfs, lfs_file_t *file,
             if (!(file->flags & LFS_F_INLINE)) {
                 int err = lfs_ctz_find(lfs, NULL, &file->cache,
                         file->ctz.head, file->ctz.size,
-                        file->pos, &file->block, &file->off);
+                        file->pos, &file->block, &file->off, &file->index);
                 if (err) {
                     return err;
                 }
@@ -2997,7 +3312,8 @@ static lfs_ssize_t lfs_file_rawwrite(lfs_t *lfs, lfs_file_t *file,
                     // find out which block we're extending from
                     int err = lfs_ctz_find(lfs, NULL, &file->cache,
                             file->ctz.head, file->ctz.size,
-                            file->pos-1, &file->block, &file->off);
+                            file->pos-1, &file->block, &file->off,
+                            &file->index);
                     if (err) {
                         file->flags |= LFS_F_ERRED;
                         return err;
@@ -3114,7 +3430,7 @@ static int lfs_file_rawtruncate(lfs_t *lfs, lfs_file_t *file, lfs_off_t size) {
         // lookup new head in ctz skip list
         err = lfs_ctz_find(lfs, NULL, &file->cache,
                 file->ctz.head, file->ctz.size,
-                size, &file->block, &file->off);
+                size, &file->block, &file->off, &file->index);
         if (err) {
             return err;
         }
@@ -3124,6 +3440,7 @@ static int lfs_file_rawtruncate(lfs_t *lfs, lfs_file_t *file, lfs_off_t size) {
         file->pos = size;
         file->ctz.head = file->block;
         file->ctz.size = size;
+        file->index.head = LFS_BLOCK_NULL;
         file->flags |= LFS_F_DIRTY | LFS_F_READING;
     } else if (size > oldsize) {
         // flush+seek if not already at end
@@ -3177,6 +3494,54 @@ static lfs_soff_t lfs_file_rawsize(lfs_t *lfs, lfs_file_t *file) {
     return file->ctz.size;
 }
 
+static int lfs_file_rawsetindex(lfs_t *lfs, lfs_file_t *file,
+        void *buffer, lfs_size_t size) {
+    (void)lfs;
+    LFS_ASSERT((uintptr_t)buffer % 4 == 0);
+    file->index.buffer = (size >= sizeof(lfs_block_t)) ? buffer : NULL;
+    file->index.size = size / sizeof(lfs_block_t);
+    file->index.head = LFS_BLOCK_NULL;
+    return 0;
+}
+
+static int lfs_file_rawbuildindex(lfs_t *lfs, lfs_file_t *file) {
+#ifndef LFS_READONLY
+    if ((file->flags & LFS_F_WRITING)) {
+        // flush out any writes, the file's cache is needed for reading
+        int err = lfs_file_flush(lfs, file);
+        if (err) {
+            return err;
+        }
+    }
+#endif
+
+    if (!file->index.buffer || (file->flags & LFS_F_INLINE) ||
+            file->ctz.size == 0) {
+        return 0;
+    }
+
+    // walk down from the end one indexed position at a time, each step
+    // starts from the position found by the one before
+    lfs_off_t last = lfs_ctz_index(lfs, &(lfs_off_t){file->ctz.size-1});
+    lfs_ctz_resetindex(&file->index, file->ctz.head, last);
+    lfs_block_t block;
+    lfs_off_t off;
+    for (lfs_off_t i = last / file->index.stride + 1; i > 0; i--) {
+        // block n starts after n full blocks less their pointers
+        lfs_off_t n = (i-1) * file->index.stride;
+        lfs_off_t pos = (n == 0) ? 0 : lfs->cfg->block_size*n -
+                4*(2*(n-1) - lfs_popc(n-1));
+        int err = lfs_ctz_find(lfs, NULL, &file->cache,
+                file->ctz.head, file->ctz.size,
+                pos, &block, &off, &file->index);
+        if (err) {
+            return err;
+        }
+    }
+
+    return 0;
+}
+
 
 /// General fs operations ///
 static int lfs_rawstat(lfs_t *lfs, const char *path, struct lfs_info *info) {
@@ -3276,6 +3641,9 @@ static int lfs_rawrename(lfs_t *lfs, const char *oldpath, const char *newpath) {
         return err;
     }
 
+    // paths below a renamed directory change without a commit to their pair
+    lfs_dcache_clear(lfs);
+
     // find old entry
     lfs_mdir_t oldcwd;
     lfs_stag_t oldtag = lfs_dir_find(lfs, &oldcwd, &oldpath, NULL);
@@ -3481,6 +3849,9 @@ static int lfs_rawremoveattr(lfs_t *lfs, const char *path, uint8_t type) {
 /// Filesystem operations ///
 static int lfs_init(lfs_t *lfs, const struct lfs_config *cfg) {
     lfs->cfg = cfg;
+    lfs->rlines = NULL;
+    lfs->mcache = NULL;
+    lfs->dcache = NULL;
     int err = 0;
 
     // validate that the lfs-cfg sizes were initiated properly before
@@ -3534,6 +3905,54 @@ static int lfs_init(lfs_t *lfs, const struct lfs_config *cfg) {
     lfs_cache_zero(lfs, &lfs->rcache);
     lfs_cache_zero(lfs, &lfs->pcache);
 
+    // setup extra read cache lines, line buffers follow the line array
+    // unless a buffer is provided
+    if (lfs->cfg->read_cache_lines) {
+        lfs_size_t n = lfs->cfg->read_cache_lines;
+        lfs->rlines = lfs_malloc(n*sizeof(lfs_cache_t) +
+                (lfs->cfg->read_cache_lines_buffer ? 0
+                    : n*lfs->cfg->cache_size));
+        if (!lfs->rlines) {
+            err = LFS_ERR_NOMEM;
+            goto cleanup;
+        }
+
+        uint8_t *buffer = lfs->cfg->read_cache_lines_buffer
+                ? lfs->cfg->read_cache_lines_buffer
+                : (uint8_t*)&lfs->rlines[n];
+        for (lfs_size_t i = 0; i < n; i++) {
+            lfs->rlines[i].buffer = &buffer[i*lfs->cfg->cache_size];
+            lfs_cache_drop(lfs, &lfs->rlines[i]);
+        }
+    }
+
+    // setup remembered metadata pairs
+    if (lfs->cfg->mdir_cache_count) {
+        lfs->mcache = lfs_malloc(
+                lfs->cfg->mdir_cache_count*sizeof(lfs_mdir_t));
+        if (!lfs->mcache) {
+            err = LFS_ERR_NOMEM;
+            goto cleanup;
+        }
+
+        for (lfs_size_t i = 0; i < lfs->cfg->mdir_cache_count; i++) {
+            lfs->mcache[i].pair[0] = LFS_BLOCK_NULL;
+            lfs->mcache[i].pair[1] = LFS_BLOCK_NULL;
+        }
+    }
+
+    // setup path lookup cache
+    if (lfs->cfg->dentry_cache_count) {
+        lfs->dcache = lfs_malloc(
+                lfs->cfg->dentry_cache_count*sizeof(struct lfs_dentry));
+        if (!lfs->dcache) {
+            err = LFS_ERR_NOMEM;
+            goto cleanup;
+        }
+
+        lfs_dcache_clear(lfs);
+    }
+
     // setup lookahead, must be multiple of 64-bits, 32-bit aligned
     LFS_ASSERT(lfs->cfg->lookahead_size > 0);
     LFS_ASSERT(lfs->cfg->lookahead_size % 8 == 0 &&
@@ -3598,6 +4017,10 @@ static int lfs_deinit(lfs_t *lfs) {
         lfs_free(lfs->pcache.buffer);
     }
 
+    lfs_free(lfs->rlines);
+    lfs_free(lfs->mcache);
+    lfs_free(lfs->dcache);
+
     if (!lfs->cfg->lookahead_buffer) {
         lfs_free(lfs->free.buffer);
     }
@@ -5265,6 +5688,38 @@ lfs_soff_t lfs_file_size(lfs_t *lfs, lfs_file_t *file) {
     return res;
 }
 
+int lfs_file_setindex(lfs_t *lfs, lfs_file_t *file,
+        void *buffer, lfs_size_t size) {
+    int err = LFS_LOCK(lfs->cfg);
+    if (err) {
+        return err;
+    }
+    LFS_TRACE("lfs_file_setindex(%p, %p, %p, %"PRIu32")",
+            (void*)lfs, (void*)file, buffer, size);
+    LFS_ASSERT(lfs_mlist_isopen(lfs->mlist, (struct lfs_mlist*)file));
+
+    err = lfs_file_rawsetindex(lfs, file, buffer, size);
+
+    LFS_TRACE("lfs_file_setindex -> %d", err);
+    LFS_UNLOCK(lfs->cfg);
+    return err;
+}
+
+int lfs_file_buildindex(lfs_t *lfs, lfs_file_t *file) {
+    int err = LFS_LOCK(lfs->cfg);
+    if (err) {
+        return err;
+    }
+    LFS_TRACE("lfs_file_buildindex(%p, %p)", (void*)lfs, (void*)file);
+    LFS_ASSERT(lfs_mlist_isopen(lfs->mlist, (struct lfs_mlist*)file));
+
+    err = lfs_file_rawbuildindex(lfs, file);
+
+    LFS_TRACE("lfs_file_buildindex -> %d", err);
+    LFS_UNLOCK(lfs->cfg);
+    return err;
+}
+
 #ifndef LFS_READONLY
 int lfs_mkdir(lfs_t *lfs, const char *path) {
     int err = LFS_LOCK(lfs->cfg);
@@ -5325,6 +5780,22 @@ int lfs_dir_read(lfs_t *lfs, lfs_dir_t *dir, struct lfs_info *info) {
     return err;
 }
 
+lfs_ssize_t lfs_dir_getattr(lfs_t *lfs, lfs_dir_t *dir,
+        uint8_t type, void *buffer, lfs_size_t size) {
+    int err = LFS_LOCK(lfs->cfg);
+    if (err) {
+        return err;
+    }
+    LFS_TRACE("lfs_dir_getattr(%p, %p, %"PRIu8", %p, %"PRIu32")",
+            (void*)lfs, (void*)dir, type, buffer, size);
+
+    lfs_ssize_t res = lfs_dir_rawgetattr(lfs, dir, type, buffer, size);
+
+    LFS_TRACE("lfs_dir_getattr -> %"PRId32, res);
+    LFS_UNLOCK(lfs->cfg);
+    return res;
+}
+
 int lfs_dir_seek(lfs_t *lfs, lfs_dir_t *dir, lfs_off_t off) {
     int err = LFS_LOCK(lfs->cfg);
     if (err) {
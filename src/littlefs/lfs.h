@@ -68,6 +68,12 @@ typedef uint32_t lfs_block_t;
 #define LFS_ATTR_MAX 1022
 #endif
 
+// Maximum path length in bytes remembered by the path lookup cache, longer
+// paths are still found but never remembered. Only affects RAM usage.
+#ifndef LFS_DCACHE_PATH_MAX
+#define LFS_DCACHE_PATH_MAX 64
+#endif
+
 // Possible error codes, these are negative to allow
 // valid positive return values
 enum lfs_error {
@@ -263,6 +269,31 @@ struct lfs_config {
     // can help bound the metadata compaction time. Must be <= block_size.
     // Defaults to block_size when zero.
     lfs_size_t metadata_max;
+
+    // Optional number of extra read cache lines, each cache_size bytes. Reads
+    // that miss the read cache are looked up in these lines before going to
+    // the block device, and the least recently used line is replaced on a
+    // miss. Useful when the block device is slow to read, such as SPI flash.
+    // Defaults to no extra lines when zero.
+    lfs_size_t read_cache_lines;
+
+    // Optional statically allocated buffer for the extra read cache lines.
+    // Must be read_cache_lines*cache_size. By default lfs_malloc is used to
+    // allocate this buffer.
+    void *read_cache_lines_buffer;
+
+    // Optional number of recently fetched metadata pairs to remember. A
+    // remembered pair is not read and checksummed again until it is
+    // programmed or erased, which speeds up repeated lookups in the same
+    // directories. Defaults to none when zero.
+    lfs_size_t mdir_cache_count;
+
+    // Optional number of slots in the path lookup cache, which remembers
+    // where recently found paths are stored so finding them again takes
+    // one metadata fetch instead of one per directory in the path. Each
+    // slot takes about LFS_DCACHE_PATH_MAX+16 bytes. Defaults to none
+    // when zero.
+    lfs_size_t dentry_cache_count;
 };
 
 // File info structure
@@ -366,6 +397,14 @@ typedef struct lfs_file {
     lfs_off_t off;
     lfs_cache_t cache;
 
+    // optional block addresses at regular positions in the file
+    struct lfs_ctzindex {
+        lfs_block_t *buffer;
+        lfs_size_t size;
+        lfs_size_t stride;
+        lfs_block_t head;
+    } index;
+
     const struct lfs_file_config *cfg;
 } lfs_file_t;
 
@@ -387,6 +426,9 @@ typedef struct lfs_gstate {
 typedef struct lfs {
     lfs_cache_t rcache;
     lfs_cache_t pcache;
+    lfs_cache_t *rlines;
+    struct lfs_mdir *mcache;
+    struct lfs_dentry *dcache;
 
     lfs_block_t root[2];
     struct lfs_mlist {
@@ -601,6 +643,24 @@ int lfs_file_rewind(lfs_t *lfs, lfs_file_t *file);
 // Returns the size of the file, or a negative error code on failure.
 lfs_soff_t lfs_file_size(lfs_t *lfs, lfs_file_t *file);
 
+// Give an open file a buffer to remember the addresses of its blocks in
+//
+// Addresses are remembered as the file is read, so reading again near a
+// remembered position doesn't walk the file's skip-list from its end. A
+// buffer of 4 bytes per block of the file remembers every block, smaller
+// buffers remember every 2nd, 4th, ... block. The buffer must stay valid
+// until the file is closed or given another buffer, NULL removes it.
+// Returns a negative error code on failure.
+int lfs_file_setindex(lfs_t *lfs, lfs_file_t *file,
+        void *buffer, lfs_size_t size);
+
+// Fill the file's index by reading its skip-list once
+//
+// Afterwards reading from any position reads at most log2 of the index
+// stride blocks to find the position. Returns a negative error code on
+// failure.
+int lfs_file_buildindex(lfs_t *lfs, lfs_file_t *file);
+
 
 /// Directory operations ///
 
@@ -630,6 +690,15 @@ int lfs_dir_close(lfs_t *lfs, lfs_dir_t *dir);
 // or a negative error code on failure.
 int lfs_dir_read(lfs_t *lfs, lfs_dir_t *dir, struct lfs_info *info);
 
+// Get a custom attribute of the entry last read from the directory
+//
+// Reads the attribute from the directory's metadata already in use, without
+// looking up the entry's path. Returns the size of the attribute, or a
+// negative error code on failure. If no attribute is found, or no entry has
+// been read, the error LFS_ERR_NOATTR is returned.
+lfs_ssize_t lfs_dir_getattr(lfs_t *lfs, lfs_dir_t *dir,
+        uint8_t type, void *buffer, lfs_size_t size);
+
 // Change the position of the directory
 //
 // The new off must be a value previous returned from tell and specifies
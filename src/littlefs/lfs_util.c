@@ -10,6 +10,10 @@
 #ifndef LFS_CONFIG
 
 
+uint32_t (*lfs_crc_engine)(uint32_t crc, const void *buffer,
+        size_t size) = NULL;
+
+#if LFS_CRC_SLICE == 0
 // Software CRC implementation with small lookup table
 uint32_t lfs_crc(uint32_t crc, const void *buffer, size_t size) {
     static const uint32_t rtable[16] = {
@@ -19,6 +23,10 @@ uint32_t lfs_crc(uint32_t crc, const void *buffer, size_t size) {
         0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c,
     };
 
+    if (lfs_crc_engine) {
+        return lfs_crc_engine(crc, buffer, size);
+    }
+
     const uint8_t *data = buffer;
 
     for (size_t i = 0; i < size; i++) {
@@ -28,6 +36,79 @@ uint32_t lfs_crc(uint32_t crc, const void *buffer, size_t size) {
 
     return crc;
 }
+#elif LFS_CRC_SLICE == 4 || LFS_CRC_SLICE == 8
+// Software CRC implementation with slice-by-4 or slice-by-8 tables, each
+// table gives the CRC of a byte followed by 0-7 zero bytes
+static uint32_t lfs_crc_table[LFS_CRC_SLICE][256];
+
+static void lfs_crc_init(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int j = 0; j < 8; j++) {
+            crc = (crc >> 1) ^ ((crc & 1) ? 0xedb88320 : 0);
+        }
+        lfs_crc_table[0][i] = crc;
+    }
+
+    for (int k = 1; k < LFS_CRC_SLICE; k++) {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t crc = lfs_crc_table[k-1][i];
+            lfs_crc_table[k][i] = (crc >> 8) ^ lfs_crc_table[0][crc & 0xff];
+        }
+    }
+}
+
+static inline uint32_t lfs_crc_le32(const uint8_t *data) {
+    return ((uint32_t)data[0] <<  0) |
+           ((uint32_t)data[1] <<  8) |
+           ((uint32_t)data[2] << 16) |
+           ((uint32_t)data[3] << 24);
+}
 
+uint32_t lfs_crc(uint32_t crc, const void *buffer, size_t size) {
+    const uint32_t (*t)[256] = (const uint32_t (*)[256])lfs_crc_table;
+    const uint8_t *data = buffer;
+
+    if (lfs_crc_engine) {
+        return lfs_crc_engine(crc, buffer, size);
+    }
+
+    // entry 1 of the first table is never zero once built
+    if (!lfs_crc_table[0][1]) {
+        lfs_crc_init();
+    }
+
+#if LFS_CRC_SLICE == 8
+    while (size >= 8) {
+        uint32_t a = crc ^ lfs_crc_le32(&data[0]);
+        uint32_t b = lfs_crc_le32(&data[4]);
+        crc = t[7][(a >>  0) & 0xff] ^ t[6][(a >>  8) & 0xff] ^
+              t[5][(a >> 16) & 0xff] ^ t[4][(a >> 24) & 0xff] ^
+              t[3][(b >>  0) & 0xff] ^ t[2][(b >>  8) & 0xff] ^
+              t[1][(b >> 16) & 0xff] ^ t[0][(b >> 24) & 0xff];
+        data += 8;
+        size -= 8;
+    }
+#endif
+
+    while (size >= 4) {
+        uint32_t a = crc ^ lfs_crc_le32(data);
+        crc = t[3][(a >>  0) & 0xff] ^ t[2][(a >>  8) & 0xff] ^
+              t[1][(a >> 16) & 0xff] ^ t[0][(a >> 24) & 0xff];
+        data += 4;
+        size -= 4;
+    }
+
+    while (size > 0) {
+        crc = (crc >> 8) ^ t[0][(crc ^ *data) & 0xff];
+        data += 1;
+        size -= 1;
+    }
+
+    return crc;
+}
+#else
+#error "LFS_CRC_SLICE must be 0, 4 or 8"
+#endif
 
 #endif
@@ -14,6 +14,13 @@
 #define LFS_NO_WARN
 #define LFS_NO_ERROR
 #define LFS_NO_ASSERT
+#ifndef LFS_CRC_SLICE
+#if defined(__IMXRT1062__)
+#define LFS_CRC_SLICE 4
+#else
+#define LFS_CRC_SLICE 0
+#endif
+#endif
 
 // Users can override lfs_util.h with their own configuration by defining
 // LFS_CONFIG as a header file to include (-DLFS_CONFIG=lfs_config.h).
@@ -221,8 +228,18 @@ static inline uint32_t lfs_tobe32(uint32_t a) {
 }
 
 // Calculate CRC-32 with polynomial = 0x04c11db7
+//
+// LFS_CRC_SLICE selects the software implementation: 0 for a 16 entry
+// nibble table, 4 or 8 for slice-by-4 or slice-by-8, which are faster but
+// build a 4 or 8 KiB table in RAM on first use.
 uint32_t lfs_crc(uint32_t crc, const void *buffer, size_t size);
 
+// Optional CRC engine, for example a hardware CRC unit. When set, lfs_crc
+// calls it instead of the software implementation. It must compute the
+// same CRC-32 as lfs_crc, without inverting the result.
+extern uint32_t (*lfs_crc_engine)(uint32_t crc, const void *buffer,
+        size_t size);
+
 // Allocate memory, only used if buffers are not provided to littlefs
 // Note, memory must be 64-bit aligned
 static inline void *lfs_malloc(size_t size) {